@@ -0,0 +1,172 @@
+/* This file contains codes related to analysing images */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "analyze.h"
+#include "types.h"
+#include "cover.h"
+#include "metrics.h"
+
+/* Function Definitions */
+/* Validating the files given through CLA */
+Status read_and_validate_analyze_args(char *argv[], AnalyzeInfo *anaInfo)
+{
+	/* Checking at least one image passed */
+    if(argv[2] == NULL)
+    {
+        return e_failure;
+    }
+    anaInfo -> image_fnames = &argv[2];
+
+    for(anaInfo -> image_count = 0; anaInfo -> image_fnames[anaInfo -> image_count] != NULL; anaInfo -> image_count++)
+        ;
+
+    /* No failure return e_success */
+    return e_success;
+}
+
+/*
+ * Run the detectors over one image
+ * Input: Image file name
+ * Output: Chi-square and RS figures of the image
+ * Description: The pixel span is streamed once through the
+ * cover format, no cover is needed to compare with.
+ */
+Status analyze_image(const char *image_fname, AnalyzeResult *result)
+{
+    unsigned char buf[METRICS_BUF_SIZE];
+    StegoMetrics metrics;
+    CoverInfo cover;
+    const CoverFormat *format;
+    FILE *fptr;
+    uint n;
+
+    memset(result, 0, sizeof (AnalyzeResult));
+    result -> status = e_failure;
+
+    format = cover_format_for_fname(image_fname);
+    if(format == NULL)
+    {
+        return e_failure;
+    }
+    result -> format_name = format -> name;
+
+    fptr = fopen(image_fname, "r");
+    if(fptr == NULL)
+    {
+        return e_failure;
+    }
+
+    if(cover_parse_header(format, fptr, &cover) == e_failure || format -> begin_span(fptr, NULL, &cover) == e_failure)
+    {
+        cover_release(&cover);
+        fclose(fptr);
+        return e_failure;
+    }
+
+    metrics_init(&metrics, cover.channels, cover.width * cover.channels, cover.row_stride);
+    while(cover.span_pos < cover.pixel_span)
+    {
+        n = cover.pixel_span - cover.span_pos;
+        n = cover_read_channels(&cover, fptr, (char *) buf, n < METRICS_BUF_SIZE ? n : METRICS_BUF_SIZE);
+        if(n == 0)
+        {
+            break;
+        }
+        metrics_update(&metrics, NULL, buf, n);
+    }
+
+    /* A short span means a truncated image */
+    if(cover.span_pos == cover.pixel_span)
+    {
+        metrics_report(&metrics, &result -> report);
+        result -> status = e_success;
+    }
+
+    cover_release(&cover);
+    fclose(fptr);
+
+    return result -> status;
+}
+
+/* Worker picking up images until none is left */
+static void *analyze_worker(void *arg)
+{
+    AnalyzeInfo *anaInfo = arg;
+    uint i;
+
+    for(;;)
+    {
+        pthread_mutex_lock(&anaInfo -> lock);
+        i = anaInfo -> next++;
+        pthread_mutex_unlock(&anaInfo -> lock);
+
+        if(i >= anaInfo -> image_count)
+        {
+            return NULL;
+        }
+        analyze_image(anaInfo -> image_fnames[i], &anaInfo -> results[i]);
+    }
+}
+
+/* Function definition for analysis, images are spread over a thread per CPU and reported in the order given */
+Status do_analysis(AnalyzeInfo *anaInfo)
+{
+    pthread_t threads[ANALYZE_MAX_THREADS];
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    uint nthreads = cpus > 0 ? cpus : 1;
+    uint started = 0;
+    char label[4096];
+
+    anaInfo -> results = calloc(anaInfo -> image_count, sizeof (AnalyzeResult));
+    if(anaInfo -> results == NULL)
+    {
+        return e_failure;
+    }
+    anaInfo -> next = 0;
+    pthread_mutex_init(&anaInfo -> lock, NULL);
+
+    if(nthreads > ANALYZE_MAX_THREADS)
+        nthreads = ANALYZE_MAX_THREADS;
+    if(nthreads > anaInfo -> image_count)
+        nthreads = anaInfo -> image_count;
+
+    for(uint i = 0; i < nthreads; i++)
+    {
+        if(pthread_create(&threads[started], NULL, analyze_worker, anaInfo) == 0)
+        {
+            started++;
+        }
+    }
+
+    /* Work on the calling thread when no worker could be started */
+    if(started == 0)
+    {
+        analyze_worker(anaInfo);
+    }
+    for(uint i = 0; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&anaInfo -> lock);
+
+    for(uint i = 0; i < anaInfo -> image_count; i++)
+    {
+        if(anaInfo -> results[i].status == e_failure)
+        {
+            printf("image=%s error=unsupported\n", anaInfo -> image_fnames[i]);
+            continue;
+        }
+
+        snprintf(label, sizeof (label), "image=%s format=%s", anaInfo -> image_fnames[i], anaInfo -> results[i].format_name);
+        metrics_print(label, &anaInfo -> results[i].report, 0);
+    }
+
+    free(anaInfo -> results);
+    anaInfo -> results = NULL;
+
+    /* No failure return e_success */
+    return e_success;
+}
@@ -0,0 +1,47 @@
+/* This file contains the function prototypes and structs for analysing images */
+
+#include <stdio.h>
+#ifndef ANALYZE_H
+#define ANALYZE_H
+
+#include <pthread.h>
+#include "types.h" // Contains user defined types
+#include "metrics.h" // Contains quality and steganalysis metrics
+
+#define ANALYZE_MAX_THREADS 16
+
+/* struct for storing the result of one image */
+typedef struct _AnalyzeResult
+{
+    const char *format_name;
+    Status status;
+    MetricsReport report;
+
+} AnalyzeResult;
+
+/* struct for storing the analysis request */
+typedef struct _AnalyzeInfo
+{
+    /* Images to analyse, NULL terminated */
+    char **image_fnames;
+    uint image_count;
+
+    /* Results in the order of the images */
+    AnalyzeResult *results;
+
+    /* Next image to pick up by a worker */
+    uint next;
+    pthread_mutex_t lock;
+
+} AnalyzeInfo;
+
+/* Read and validate Analyze args from argv */
+Status read_and_validate_analyze_args(char *argv[], AnalyzeInfo *anaInfo);
+
+/* Run the detectors over one image */
+Status analyze_image(const char *image_fname, AnalyzeResult *result);
+
+/* Perform the analysis */
+Status do_analysis(AnalyzeInfo *anaInfo);
+
+#endif
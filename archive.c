@@ -0,0 +1,270 @@
+/* This file contains codes related to the multi file archive */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include "archive.h"
+#include "types.h"
+
+#define ARCHIVE_READ_BUF_SIZE 4096
+
+/* Function Definitions */
+
+/* Store a big endian 32 bit value */
+static void archive_put32(unsigned char *buf, uint value)
+{
+    for(int i = 0; i < 4; i++)
+    {
+        buf[i] = value >> (8 * (3 - i));
+    }
+}
+
+/* Load a big endian 32 bit value */
+static uint archive_get32(const unsigned char *buf)
+{
+    return (uint) buf[0] << 24 | (uint) buf[1] << 16 | (uint) buf[2] << 8 | buf[3];
+}
+
+/* Function definition to check a member name is a plain file name */
+int archive_name_ok(const char *name)
+{
+    size_t len = strlen(name);
+
+	/* Names come back as output file names, so no directories */
+    return len > 0 && len <= ARCHIVE_MAX_NAME && strchr(name, '/') == NULL &&
+           strcmp(name, ".") != 0 && strcmp(name, "..") != 0;
+}
+
+/* Size and CRC-32 of a member file */
+static Status archive_scan_file(ArchiveEntry *entry)
+{
+    unsigned char buf[ARCHIVE_READ_BUF_SIZE];
+    FILE *fptr = fopen(entry->fname, "r");
+    unsigned long long length = 0;
+    uLong crc = crc32(0, Z_NULL, 0);
+    size_t n;
+
+    if(fptr == NULL)
+    {
+        perror("fopen");
+        fprintf(stderr, "ERROR: Unable to open file %s\n", entry->fname);
+        return e_failure;
+    }
+
+    while((n = fread(buf, 1, sizeof (buf), fptr)) > 0)
+    {
+        crc = crc32(crc, buf, n);
+        length += n;
+    }
+    fclose(fptr);
+
+    if(length > (uint) -1)
+    {
+        fprintf(stderr, "ERROR: %s is too large for an archive member\n", entry->fname);
+        return e_failure;
+    }
+    entry->length = length;
+    entry->crc = crc;
+
+    return e_success;
+}
+
+/*
+ * Build the archive index
+ * Input: Member file names
+ * Output: Entries named after the base names of the files, with
+ * their offsets, lengths and CRC-32s
+ * Description: The files are read once here for their CRC-32 and
+ * once more when they are embedded.
+ */
+Status archive_build(Archive *archive, char **fnames)
+{
+    uint count = 0;
+
+    memset(archive, 0, sizeof (Archive));
+    while(fnames[count] != NULL)
+    {
+        count++;
+    }
+    if(count == 0 || count > ARCHIVE_MAX_ENTRIES)
+    {
+        fprintf(stderr, "ERROR: An archive holds 1 to %d files\n", ARCHIVE_MAX_ENTRIES);
+        return e_failure;
+    }
+
+    archive->entries = calloc(count, sizeof (ArchiveEntry));
+    if(archive->entries == NULL)
+    {
+        return e_failure;
+    }
+    archive->allocated = count;
+    archive->index_size = ARCHIVE_COUNT_BYTES;
+
+    for(uint i = 0; i < count; i++)
+    {
+        ArchiveEntry *entry = &archive->entries[i];
+        const char *name = strrchr(fnames[i], '/') != NULL ? strrchr(fnames[i], '/') + 1 : fnames[i];
+
+        if(!archive_name_ok(name) || archive_find(archive, name) != NULL)
+        {
+            fprintf(stderr, "ERROR: %s is not a valid or unique member name\n", fnames[i]);
+            archive_free(archive);
+            return e_failure;
+        }
+
+        strcpy(entry->name, name);
+        entry->fname = fnames[i];
+        entry->offset = archive->data_size;
+        if(archive_scan_file(entry) == e_failure)
+        {
+            archive_free(archive);
+            return e_failure;
+        }
+
+        /* Offsets are 32 bit */
+        archive->data_size += entry->length;
+        archive->index_size += ARCHIVE_ENTRY_FIXED_BYTES + strlen(name);
+        archive->count++;
+        if(archive->data_size > (uint) -1)
+        {
+            fprintf(stderr, "ERROR: Archive members add up to more than 4 GiB\n");
+            archive_free(archive);
+            return e_failure;
+        }
+    }
+
+    return e_success;
+}
+
+/* Function definition to serialize the index */
+void archive_write_index(const Archive *archive, unsigned char *buf)
+{
+    archive_put32(buf, archive->count);
+    buf += ARCHIVE_COUNT_BYTES;
+
+    for(uint i = 0; i < archive->count; i++)
+    {
+        const ArchiveEntry *entry = &archive->entries[i];
+        size_t len = strlen(entry->name);
+
+        *buf++ = len;
+        memcpy(buf, entry->name, len);
+        buf += len;
+        archive_put32(buf, entry->offset);
+        archive_put32(buf + 4, entry->length);
+        archive_put32(buf + 8, entry->crc);
+        buf += ARCHIVE_ENTRY_FIXED_BYTES - 1;
+    }
+}
+
+/* Function definition to start an index from its entry count */
+Status archive_begin_index(Archive *archive, const unsigned char *buf, unsigned long long archive_size)
+{
+    uint count = archive_get32(buf);
+
+    memset(archive, 0, sizeof (Archive));
+
+	/* Every entry takes at least its fixed bytes and a one byte name */
+    if(count == 0 || count > ARCHIVE_MAX_ENTRIES ||
+       ARCHIVE_COUNT_BYTES + (unsigned long long) count * (ARCHIVE_ENTRY_FIXED_BYTES + 1) > archive_size)
+    {
+        return e_failure;
+    }
+
+    archive->entries = calloc(count, sizeof (ArchiveEntry));
+    if(archive->entries == NULL)
+    {
+        return e_failure;
+    }
+    archive->index_size = ARCHIVE_COUNT_BYTES;
+    archive->allocated = count;
+
+    return e_success;
+}
+
+/* Function definition to get the bytes of an entry after its name length byte */
+uint archive_entry_size(unsigned char name_len)
+{
+    return name_len + ARCHIVE_ENTRY_FIXED_BYTES - 1;
+}
+
+/* Function definition to parse the next entry */
+Status archive_add_entry(Archive *archive, unsigned char name_len, const unsigned char *buf)
+{
+    ArchiveEntry *entry;
+
+    if(archive->count >= archive->allocated || name_len == 0)
+    {
+        return e_failure;
+    }
+
+    entry = &archive->entries[archive->count];
+    memcpy(entry->name, buf, name_len);
+    entry->name[name_len] = '\0';
+    entry->offset = archive_get32(buf + name_len);
+    entry->length = archive_get32(buf + name_len + 4);
+    entry->crc = archive_get32(buf + name_len + 8);
+
+	/* Names with a NUL or a directory are refused, with duplicates the first one wins */
+    if(strlen(entry->name) != name_len || !archive_name_ok(entry->name))
+    {
+        return e_failure;
+    }
+
+    archive->index_size += ARCHIVE_ENTRY_FIXED_BYTES + name_len;
+    archive->count++;
+
+    return e_success;
+}
+
+/* Function definition to check the entries cover the member data exactly */
+Status archive_finish_index(Archive *archive, unsigned long long archive_size)
+{
+    unsigned long long offset = 0;
+
+    if(archive->count != archive->allocated || archive->index_size > archive_size)
+    {
+        return e_failure;
+    }
+
+	/* Members follow each other in index order */
+    for(uint i = 0; i < archive->count; i++)
+    {
+        if(archive->entries[i].offset != offset)
+        {
+            return e_failure;
+        }
+        offset += archive->entries[i].length;
+    }
+    if(archive->index_size + offset != archive_size)
+    {
+        return e_failure;
+    }
+    archive->data_size = offset;
+
+    return e_success;
+}
+
+/* Function definition to find an entry by name */
+const ArchiveEntry *archive_find(const Archive *archive, const char *name)
+{
+    for(uint i = 0; i < archive->count; i++)
+    {
+        if(strcmp(archive->entries[i].name, name) == 0)
+        {
+            return &archive->entries[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* Function definition to free the entries */
+void archive_free(Archive *archive)
+{
+    free(archive->entries);
+    archive->entries = NULL;
+    archive->count = 0;
+    archive->allocated = 0;
+}
@@ -0,0 +1,69 @@
+/* This file contains the function prototypes and structs of the multi file archive */
+
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include "types.h" // Contains user defined types
+
+#define ARCHIVE_MAX_NAME 255
+#define ARCHIVE_MAX_ENTRIES 65535
+#define ARCHIVE_COUNT_BYTES 4
+#define ARCHIVE_ENTRY_FIXED_BYTES 13    // Name length, offset, length and CRC-32 of an entry
+
+/*
+ * The archive is the secret data of the plain layout:
+ *   entry count (4 bytes)
+ *   per entry: name length (1), name, offset (4), length (4), CRC-32 (4)
+ *   member data, one member after the other
+ * Numbers are big endian. Offsets count from the first member byte,
+ * so the cover position of a member is known from the index alone.
+ */
+typedef struct _ArchiveEntry
+{
+    char name[ARCHIVE_MAX_NAME + 1];
+    const char *fname;          // File the member is read from when encoding
+    uint offset;
+    uint length;
+    uint crc;
+
+} ArchiveEntry;
+
+/* struct for storing the index of an archive */
+typedef struct _Archive
+{
+    ArchiveEntry *entries;
+    uint count;
+    uint allocated;             // Entries the index announced
+    uint index_size;            // Bytes of the count and the entries
+    unsigned long long data_size;
+
+} Archive;
+
+/* Build the index of the files to embed, NULL terminated */
+Status archive_build(Archive *archive, char **fnames);
+
+/* Serialize the index into buf of index_size bytes */
+void archive_write_index(const Archive *archive, unsigned char *buf);
+
+/* Start an index from its entry count, checked against the archive size */
+Status archive_begin_index(Archive *archive, const unsigned char *buf, unsigned long long archive_size);
+
+/* Bytes of an entry after its name length byte */
+uint archive_entry_size(unsigned char name_len);
+
+/* Parse the next entry, buf holds the bytes after its name length byte */
+Status archive_add_entry(Archive *archive, unsigned char name_len, const unsigned char *buf);
+
+/* Check the entries cover the member data exactly */
+Status archive_finish_index(Archive *archive, unsigned long long archive_size);
+
+/* Find an entry by name */
+const ArchiveEntry *archive_find(const Archive *archive, const char *name);
+
+/* Check a member name is a plain file name */
+int archive_name_ok(const char *name);
+
+/* Free the entries */
+void archive_free(Archive *archive);
+
+#endif
@@ -0,0 +1,293 @@
+/* This file contains the benchmark of the bit kernels and of whole encode and decode runs, also used to train PGO builds */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "../encode.h"
+#include "../decode.h"
+#include "../kernels.h"
+#include "../types.h"
+
+#define BENCH_KERNEL_BYTES (16u << 20)
+#define BENCH_WIDTH 2048
+#define BENCH_HEIGHT 1536
+#define BENCH_SECRET_BYTES (256u << 10)
+
+static const char *const bench_kernels[] = { "generic", "sse2", "avx2", "avx512", NULL };
+
+/* Seconds on the monotonic clock */
+static double bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Fill a buffer with reproducible noise */
+static void bench_fill(char *buf, size_t n, unsigned int seed)
+{
+    for(size_t i = 0; i < n; i++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        buf[i] = seed >> 16;
+    }
+}
+
+/* Time embed and extract of every kernel this CPU runs, checking them against the generic ones */
+static Status bench_kernels_run(int iterations)
+{
+    char *channels = malloc(BENCH_KERNEL_BYTES);
+    char *reference = malloc(BENCH_KERNEL_BYTES);
+    char *payload = malloc(BENCH_KERNEL_BYTES / 8);
+    char *extracted = malloc(BENCH_KERNEL_BYTES / 8);
+    Status ret = e_success;
+
+    if(channels == NULL || reference == NULL || payload == NULL || extracted == NULL)
+    {
+        free(channels); free(reference); free(payload); free(extracted);
+        return e_failure;
+    }
+
+    bench_fill(payload, BENCH_KERNEL_BYTES / 8, 1);
+    bench_fill(reference, BENCH_KERNEL_BYTES, 2);
+    lsb_kernels_generic.embed(reference, payload, BENCH_KERNEL_BYTES / 8);
+
+    for(int k = 0; bench_kernels[k] != NULL; k++)
+    {
+        const LsbKernels *kernels = lsb_kernels_by_name(bench_kernels[k]);
+        double start, embed_time, extract_time;
+
+        if(kernels == NULL)
+        {
+            printf("kernel=%s available=no\n", bench_kernels[k]);
+            continue;
+        }
+
+        bench_fill(channels, BENCH_KERNEL_BYTES, 2);
+        start = bench_now();
+        for(int i = 0; i < iterations; i++)
+        {
+            kernels->embed(channels, payload, BENCH_KERNEL_BYTES / 8);
+        }
+        embed_time = bench_now() - start;
+
+        start = bench_now();
+        for(int i = 0; i < iterations; i++)
+        {
+            kernels->extract(extracted, channels, BENCH_KERNEL_BYTES / 8);
+        }
+        extract_time = bench_now() - start;
+
+        if(memcmp(channels, reference, BENCH_KERNEL_BYTES) != 0 || memcmp(extracted, payload, BENCH_KERNEL_BYTES / 8) != 0)
+        {
+            printf("kernel=%s error=mismatch\n", kernels->name);
+            ret = e_failure;
+            continue;
+        }
+
+        printf("kernel=%s embed_mbps=%.0f extract_mbps=%.0f\n", kernels->name,
+               iterations * (BENCH_KERNEL_BYTES >> 20) / embed_time, iterations * (BENCH_KERNEL_BYTES >> 20) / extract_time);
+    }
+
+    free(channels);
+    free(reference);
+    free(payload);
+    free(extracted);
+
+    return ret;
+}
+
+/* Write a noisy 24 bit BMP cover and a secret file */
+static Status bench_make_files(const char *cover_fname, const char *secret_fname)
+{
+    uint stride = (BENCH_WIDTH * 3 + 3) & ~3u;
+    uint span = stride * BENCH_HEIGHT;
+    unsigned char header[54] = { 'B', 'M' };
+    char *buf = malloc(span > BENCH_SECRET_BYTES ? span : BENCH_SECRET_BYTES);
+    FILE *fptr;
+
+    if(buf == NULL)
+    {
+        return e_failure;
+    }
+
+    /* File size, pixel offset, info header size, width, height, planes, bits per pixel and no compression, image size */
+    uint fields[][2] = { { 2, 54 + span }, { 10, 54 }, { 14, 40 }, { 18, BENCH_WIDTH }, { 22, BENCH_HEIGHT }, { 26, 1 }, { 28, 24 }, { 34, span } };
+    for(uint f = 0; f < sizeof (fields) / sizeof (fields[0]); f++)
+    {
+        for(int i = 0; i < 4; i++)
+        {
+            header[fields[f][0] + i] = fields[f][1] >> (8 * i);
+        }
+    }
+
+    fptr = fopen(cover_fname, "w");
+    if(fptr == NULL)
+    {
+        free(buf);
+        return e_failure;
+    }
+    bench_fill(buf, span, 3);
+    fwrite(header, 1, sizeof (header), fptr);
+    fwrite(buf, 1, span, fptr);
+    fclose(fptr);
+
+    fptr = fopen(secret_fname, "w");
+    if(fptr == NULL)
+    {
+        free(buf);
+        return e_failure;
+    }
+    bench_fill(buf, BENCH_SECRET_BYTES, 4);
+    fwrite(buf, 1, BENCH_SECRET_BYTES, fptr);
+    fclose(fptr);
+    free(buf);
+
+    return e_success;
+}
+
+/* Compare two files byte by byte */
+static int bench_same_file(const char *a, const char *b)
+{
+    FILE *fa = fopen(a, "r");
+    FILE *fb = fopen(b, "r");
+    int same = fa != NULL && fb != NULL;
+    int ca, cb;
+
+    while(same)
+    {
+        ca = fgetc(fa);
+        cb = fgetc(fb);
+        same = ca == cb;
+        if(ca == EOF)
+        {
+            break;
+        }
+    }
+
+    if(fa != NULL)
+        fclose(fa);
+    if(fb != NULL)
+        fclose(fb);
+
+    return same;
+}
+
+/* Encode and decode the cover in one embedding mode, the progress messages of both go to /dev/null */
+static Status bench_round_trip(const char *dir, const char *mode, int adaptive, uint hamming_k, StegoMetrics *metrics)
+{
+    char cover_fname[256], secret_fname[256], stego_fname[256], decode_fname[256];
+    EncodeInfo encInfo;
+    DecodeInfo decInfo;
+    double start, encode_time, decode_time;
+    Status ret;
+    int saved_stdout = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+
+    snprintf(cover_fname, sizeof (cover_fname), "%s/cover.bmp", dir);
+    snprintf(secret_fname, sizeof (secret_fname), "%s/secret.txt", dir);
+    snprintf(stego_fname, sizeof (stego_fname), "%s/stego.bmp", dir);
+    snprintf(decode_fname, sizeof (decode_fname), "%s/decode.txt", dir);
+
+    fflush(stdout);
+    dup2(null_fd, STDOUT_FILENO);
+
+    memset(&encInfo, 0, sizeof (encInfo));
+    encInfo.cover.format = &bmp_format;
+    encInfo.src_image_fname = cover_fname;
+    encInfo.secret_fname = secret_fname;
+    encInfo.stego_image_fname = stego_fname;
+    encInfo.adaptive = adaptive;
+    encInfo.hamming_k = hamming_k;
+    encInfo.metrics = metrics;
+
+    start = bench_now();
+    ret = do_encoding(&encInfo);
+    close_files(&encInfo);
+    encode_time = bench_now() - start;
+
+    memset(&decInfo, 0, sizeof (decInfo));
+    decInfo.cover.format = &bmp_format;
+    decInfo.stego_image_fname = stego_fname;
+    decInfo.decode_fname = decode_fname;
+
+    start = bench_now();
+    if(ret == e_success)
+    {
+        ret = do_decoding(&decInfo);
+    }
+    close_decode_files(&decInfo);
+    decode_time = bench_now() - start;
+
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+    close(null_fd);
+
+    if(ret == e_failure || !bench_same_file(secret_fname, decode_fname))
+    {
+        printf("mode=%s error=round_trip\n", mode);
+        return e_failure;
+    }
+
+    printf("mode=%s encode_ms=%.1f decode_ms=%.1f\n", mode, encode_time * 1000, decode_time * 1000);
+
+    return e_success;
+}
+
+/*
+ * Usage: bench_stego [iterations]
+ * Prints one key=value line per kernel and per embedding mode,
+ * exits non zero when a kernel or a round trip gives wrong data.
+ */
+int main(int argc, char *argv[])
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 8;
+    char dir[] = "/tmp/stego-bench-XXXXXX";
+    char cover_fname[256], secret_fname[256];
+    StegoMetrics metrics;
+    Status ret;
+
+    if(iterations <= 0)
+    {
+        iterations = 1;
+    }
+
+    printf("kernel_selected=%s\n", lsb_kernels()->name);
+    ret = bench_kernels_run(iterations);
+
+    if(mkdtemp(dir) == NULL)
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+    snprintf(cover_fname, sizeof (cover_fname), "%s/cover.bmp", dir);
+    snprintf(secret_fname, sizeof (secret_fname), "%s/secret.txt", dir);
+
+    if(bench_make_files(cover_fname, secret_fname) == e_failure ||
+       bench_round_trip(dir, "lsb", 0, 0, NULL) == e_failure ||
+       bench_round_trip(dir, "lsb_metrics", 0, 0, &metrics) == e_failure ||
+       bench_round_trip(dir, "hamming3", 0, 3, NULL) == e_failure ||
+       bench_round_trip(dir, "adaptive", 1, 0, NULL) == e_failure)
+    {
+        ret = e_failure;
+    }
+
+    /* Leave nothing behind */
+    const char *const names[] = { "cover.bmp", "secret.txt", "stego.bmp", "decode.txt" };
+    for(int i = 0; i < 4; i++)
+    {
+        char fname[256];
+
+        snprintf(fname, sizeof (fname), "%s/%s", dir, names[i]);
+        unlink(fname);
+    }
+    rmdir(dir);
+
+    return ret == e_success ? 0 : 1;
+}
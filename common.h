@@ -4,4 +4,14 @@
 /* Magic string to identify whether stegged or not */
 #define MAGIC_STRING "#*"
 
+/* Magic string of stego images with a parameter block after it */
+#define PARAM_MAGIC_STRING "#@"
+
+/* Parameter block: flags byte, then the texture threshold of adaptive embedding */
+#define PARAM_BYTES 2
+#define PARAM_ADAPTIVE 0x01
+#define PARAM_ARCHIVE 0x02          // Secret data is an archive of several files
+#define PARAM_HAMMING_SHIFT 4       // Hamming code k in the high nibble, 0 for one bit per channel byte
+#define PARAM_RESERVED 0x0C
+
 #endif
@@ -0,0 +1,294 @@
+/* This file contains codes related to the cover image format layer */
+
+#include <stdio.h>
+#include <string.h>
+#include "cover.h"
+#include "types.h"
+#include "metrics.h"
+
+/* Registered cover formats, looked up by file extension */
+static const CoverFormat *cover_formats[] =
+{
+    &bmp_format,
+    &ppm_format,
+    &tga_format,
+    &png_format,
+    NULL
+};
+
+/* Function Definitions */
+
+/* Function definition to find the format from the file name extension */
+const CoverFormat *cover_format_for_fname(const char *fname)
+{
+    const char *extn = strrchr(fname, '.');
+
+    /* File names without an extension have no format */
+    if(extn == NULL)
+    {
+        return NULL;
+    }
+
+    for(int i = 0; cover_formats[i] != NULL; i++)
+    {
+        for(int j = 0; cover_formats[i]->extns[j] != NULL; j++)
+        {
+            if(strcmp(extn, cover_formats[i]->extns[j]) == 0)
+            {
+                return cover_formats[i];
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Validate a parsed header against the real file
+ * Description: The geometry must not have wrapped around in the
+ * 32 bit sums of the parsers, and raw spans must start after the
+ * header and end inside the file. Past this check the kernels
+ * read the span without checking every byte.
+ */
+static Status cover_validate(FILE *fptr, CoverInfo *cover)
+{
+    unsigned long long row_len = (unsigned long long) cover->width * cover->channels;
+    long header_end = ftell(fptr);
+    long file_len;
+
+    if(cover->width == 0 || cover->height == 0 || cover->channels == 0 ||
+       cover->row_stride < row_len || (unsigned long long) cover->row_stride * cover->height != cover->pixel_span)
+    {
+        return e_failure;
+    }
+
+	/* Compressed spans are checked by the format while streaming */
+    if(!cover->format->raw_layout)
+    {
+        return e_success;
+    }
+
+    if(fseek(fptr, 0, SEEK_END) != 0 || (file_len = ftell(fptr)) < 0)
+    {
+        return e_failure;
+    }
+
+    if(cover->pixel_offset < header_end || cover->pixel_offset > file_len ||
+       cover->pixel_span > (unsigned long) (file_len - cover->pixel_offset))
+    {
+        return e_failure;
+    }
+
+    return e_success;
+}
+
+/* Function definition to parse the cover header with the given format */
+Status cover_parse_header(const CoverFormat *format, FILE *fptr, CoverInfo *cover)
+{
+    memset(cover, 0, sizeof (CoverInfo));
+    cover->format = format;
+
+    /* Start parsing from the beginning of the file */
+    fseek(fptr, 0, SEEK_SET);
+
+    if(format->parse_header(fptr, cover) == e_failure || cover_validate(fptr, cover) == e_failure)
+    {
+        return e_failure;
+    }
+
+    return e_success;
+}
+
+/* Function definition to read channel bytes from the span */
+uint cover_read_channels(CoverInfo *cover, FILE *fptr, char *buf, uint n)
+{
+    n = cover->format->read_channels(cover, fptr, buf, n);
+    cover->span_pos += n;
+
+    /* Keep the cover bytes until the stego bytes are written back */
+    if(cover->metrics != NULL && n <= METRICS_BUF_SIZE)
+    {
+        memcpy(cover->metrics->cover_buf, buf, n);
+        cover->metrics->cover_len = n;
+    }
+
+    return n;
+}
+
+/*
+ * Skip channel bytes of the span
+ * Description: Raw spans read through stdio are seeked over, the
+ * I/O engine and compressed spans read the bytes and drop them.
+ */
+Status cover_skip_channels(CoverInfo *cover, FILE *fptr, unsigned long long n)
+{
+    char buf[COVER_COPY_BUF_SIZE];
+
+    if(cover->span_pos > cover->pixel_span || n > cover->pixel_span - cover->span_pos)
+    {
+        return e_failure;
+    }
+
+    if(cover->format->raw_layout && cover->io == NULL)
+    {
+        if(fseek(fptr, (long) n, SEEK_CUR) != 0)
+        {
+            return e_failure;
+        }
+        cover->span_pos += n;
+
+        return e_success;
+    }
+
+    while(n > 0)
+    {
+        uint len = n < sizeof (buf) ? (uint) n : (uint) sizeof (buf);
+
+        if(cover->format->read_channels(cover, fptr, buf, len) != len)
+        {
+            return e_failure;
+        }
+        cover->span_pos += len;
+        n -= len;
+    }
+
+    return e_success;
+}
+
+/* Function definition to write channel bytes to the span */
+uint cover_write_channels(CoverInfo *cover, FILE *fptr, const char *buf, uint n)
+{
+    /* Every write follows the read of the same bytes */
+    if(cover->metrics != NULL)
+    {
+        metrics_update(cover->metrics, n == cover->metrics->cover_len ? cover->metrics->cover_buf : NULL,
+                       (const unsigned char *) buf, n);
+        cover->metrics->cover_len = 0;
+    }
+
+    return cover->format->write_channels(cover, fptr, buf, n);
+}
+
+/* Function definition to stream the rest of a raw layout cover through the I/O engine */
+Status cover_attach_io(CoverInfo *cover, FILE *src, FILE *dest)
+{
+    /* Compressed spans are produced by the format itself and stay on stdio */
+    if(!cover->format->raw_layout)
+    {
+        printf("%s covers are streamed by the format, using stdio\n", cover->format->name);
+        return e_success;
+    }
+
+    /* In memory images have no file descriptor to stream from */
+    if(fileno(src) < 0 || (dest != NULL && fileno(dest) < 0))
+    {
+        return e_success;
+    }
+
+    cover->io = io_engine_open(src, dest, cover->pixel_offset);
+
+    return cover->io != NULL ? e_success : e_failure;
+}
+
+/* Function definition to release format private state */
+void cover_release(CoverInfo *cover)
+{
+    if(cover->format != NULL)
+    {
+        cover->format->release(cover);
+    }
+}
+
+/* Function definition to copy the bytes before the span and position src on the span */
+Status raw_begin_span(FILE *src, FILE *dest, CoverInfo *cover)
+{
+    char buf[COVER_COPY_BUF_SIZE];
+    long left = cover->pixel_offset;
+
+    /* Decoding only needs the position */
+    if(dest == NULL)
+    {
+        return fseek(src, cover->pixel_offset, SEEK_SET) == 0 ? e_success : e_failure;
+    }
+
+    fseek(src, 0, SEEK_SET);
+
+    /* Copy the header bytes as they are */
+    while(left > 0)
+    {
+        size_t n = left < COVER_COPY_BUF_SIZE ? left : COVER_COPY_BUF_SIZE;
+
+        if(fread(buf, 1, n, src) != n || fwrite(buf, 1, n, dest) != n)
+        {
+            return e_failure;
+        }
+        left -= n;
+    }
+
+    return e_success;
+}
+
+/* Function definition to read raw channel bytes */
+uint raw_read_channels(CoverInfo *cover, FILE *fptr, char *buf, uint n)
+{
+    if(cover->io != NULL)
+    {
+        return io_engine_read(cover->io, buf, n);
+    }
+
+    return fread(buf, 1, n, fptr);
+}
+
+/* Function definition to write raw channel bytes */
+uint raw_write_channels(CoverInfo *cover, FILE *fptr, const char *buf, uint n)
+{
+    if(cover->io != NULL)
+    {
+        return io_engine_write(cover->io, buf, n);
+    }
+
+    return fwrite(buf, 1, n, fptr);
+}
+
+/* Function definition to copy everything after the span until end of file */
+Status raw_end_span(FILE *src, FILE *dest, CoverInfo *cover)
+{
+    char buf[COVER_COPY_BUF_SIZE];
+    size_t n;
+
+    /* The engine streams until end of file, then waits for the writes behind */
+    if(cover->io != NULL)
+    {
+        Status ret = io_engine_drain(cover->io);
+
+        if(io_engine_close(cover->io) == e_failure)
+        {
+            ret = e_failure;
+        }
+        cover->io = NULL;
+
+        return ret;
+    }
+
+    while((n = fread(buf, 1, COVER_COPY_BUF_SIZE, src)) > 0)
+    {
+        if(fwrite(buf, 1, n, dest) != n)
+        {
+            return e_failure;
+        }
+    }
+
+	/* A full disk may only show once the buffered tail is written */
+    return fflush(dest) == 0 ? e_success : e_failure;
+}
+
+/* Raw formats keep no private state besides the I/O engine */
+void raw_release(CoverInfo *cover)
+{
+    if(cover->io != NULL)
+    {
+        io_engine_close(cover->io);
+        cover->io = NULL;
+    }
+    cover->priv = NULL;
+}
@@ -0,0 +1,104 @@
+/* This file contains the cover image format layer shared by encoding and decoding */
+
+#include <stdio.h>
+#ifndef COVER_H
+#define COVER_H
+
+#include "types.h" // Contains user defined types
+#include "io_engine.h" // Contains the asynchronous I/O engine
+
+#define COVER_COPY_BUF_SIZE 4096
+
+struct _CoverFormat;
+struct _StegoMetrics;
+
+/*
+ * Structure to store the parsed header of a cover image.
+ * Every format exposes its samples as a span of 8 bit
+ * channel bytes, and the embed and extract kernels only
+ * ever see that span.
+ */
+typedef struct _CoverInfo
+{
+    /* Format which parsed this cover */
+    const struct _CoverFormat *format;
+
+    /* Image geometry */
+    uint width;
+    uint height;
+    uint channels;              // Channel bytes per pixel
+    uint row_stride;            // Bytes from one row of the span to the next
+
+    /* Pixel span */
+    long pixel_offset;          // File offset of the first channel byte
+    uint pixel_span;            // Number of channel bytes in the span
+    uint span_pos;              // Channel bytes read so far
+
+    /* Format private streaming state */
+    void *priv;
+
+    /* Asynchronous engine streaming the span, NULL for stdio */
+    IoEngine *io;
+
+    /* Metrics updated with every span write, NULL when not wanted */
+    struct _StegoMetrics *metrics;
+
+} CoverInfo;
+
+/*
+ * Operations every cover format implements.
+ * begin_span positions src on the first channel byte and, when
+ * dest is not NULL, copies everything before it to dest.
+ * end_span copies everything after the span to dest.
+ */
+typedef struct _CoverFormat
+{
+    const char *name;
+    const char *const *extns;
+    const char *default_stego_fname;
+    int raw_layout;             // Span is stored as raw bytes, so it can be streamed by the I/O engine
+
+    Status (*parse_header)(FILE *fptr, CoverInfo *cover);
+    Status (*begin_span)(FILE *src, FILE *dest, CoverInfo *cover);
+    uint (*read_channels)(CoverInfo *cover, FILE *fptr, char *buf, uint n);
+    uint (*write_channels)(CoverInfo *cover, FILE *fptr, const char *buf, uint n);
+    Status (*end_span)(FILE *src, FILE *dest, CoverInfo *cover);
+    void (*release)(CoverInfo *cover);
+
+} CoverFormat;
+
+/* Supported cover formats */
+extern const CoverFormat bmp_format;
+extern const CoverFormat ppm_format;
+extern const CoverFormat tga_format;
+extern const CoverFormat png_format;
+
+/* Find the cover format matching the file name extension */
+const CoverFormat *cover_format_for_fname(const char *fname);
+
+/* Parse the cover header with the given format */
+Status cover_parse_header(const CoverFormat *format, FILE *fptr, CoverInfo *cover);
+
+/* Read channel bytes from the span */
+uint cover_read_channels(CoverInfo *cover, FILE *fptr, char *buf, uint n);
+
+/* Skip channel bytes of the span without decoding them */
+Status cover_skip_channels(CoverInfo *cover, FILE *fptr, unsigned long long n);
+
+/* Write channel bytes to the span */
+uint cover_write_channels(CoverInfo *cover, FILE *fptr, const char *buf, uint n);
+
+/* Stream the span of a raw layout cover through the I/O engine */
+Status cover_attach_io(CoverInfo *cover, FILE *src, FILE *dest);
+
+/* Release format private state */
+void cover_release(CoverInfo *cover);
+
+/* Helpers for formats storing the span as raw bytes in the file */
+Status raw_begin_span(FILE *src, FILE *dest, CoverInfo *cover);
+uint raw_read_channels(CoverInfo *cover, FILE *fptr, char *buf, uint n);
+uint raw_write_channels(CoverInfo *cover, FILE *fptr, const char *buf, uint n);
+Status raw_end_span(FILE *src, FILE *dest, CoverInfo *cover);
+void raw_release(CoverInfo *cover);
+
+#endif
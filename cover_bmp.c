@@ -0,0 +1,94 @@
+/* This file contains the BMP cover format */
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include "cover.h"
+#include "types.h"
+
+/* BMP header offsets */
+#define BMP_HEADER_SIZE 54
+#define BMP_OFFSET_PIXEL_DATA 10
+#define BMP_OFFSET_WIDTH 18
+#define BMP_OFFSET_HEIGHT 22
+#define BMP_OFFSET_BITS_PER_PIXEL 28
+#define BMP_OFFSET_COMPRESSION 30
+
+/* Read a little endian value of the given width from the header */
+static uint bmp_le(const unsigned char *header, int offset, int width)
+{
+    uint value = 0;
+
+    for(int i = width - 1; i >= 0; i--)
+    {
+        value = (value << 8) | header[offset + i];
+    }
+
+    return value;
+}
+
+/*
+ * Parse BMP header
+ * Input: Image file ptr
+ * Output: width, height and pixel span of the image
+ * Description: In BMP Image, the pixel data offset is stored in offset 10,
+ * width is stored in offset 18 and height after that. size is 4 bytes.
+ * Only uncompressed 24 and 32 bit images are accepted, rows are padded
+ * to 4 bytes and the padding is part of the span.
+ */
+static Status parse_bmp_header(FILE *fptr_image, CoverInfo *cover)
+{
+    unsigned char header[BMP_HEADER_SIZE];
+    int height;
+    uint bpp;
+
+    if(fread(header, 1, BMP_HEADER_SIZE, fptr_image) != BMP_HEADER_SIZE)
+    {
+        return e_failure;
+    }
+
+    /* Check the BM signature */
+    if(header[0] != 'B' || header[1] != 'M')
+    {
+        return e_failure;
+    }
+
+    bpp = bmp_le(header, BMP_OFFSET_BITS_PER_PIXEL, 2);
+    if((bpp != 24 && bpp != 32) || bmp_le(header, BMP_OFFSET_COMPRESSION, 4) != 0)
+    {
+        return e_failure;
+    }
+
+    /* Negative height is a top down image, INT_MIN has no positive counterpart */
+    height = (int) bmp_le(header, BMP_OFFSET_HEIGHT, 4);
+    if(height == INT_MIN)
+    {
+        return e_failure;
+    }
+
+    cover->width = bmp_le(header, BMP_OFFSET_WIDTH, 4);
+    cover->height = height < 0 ? -height : height;
+    cover->channels = bpp / 8;
+    cover->row_stride = (cover->width * cover->channels + 3) & ~3u;
+    cover->pixel_offset = bmp_le(header, BMP_OFFSET_PIXEL_DATA, 4);
+    cover->pixel_span = cover->row_stride * cover->height;
+
+    return e_success;
+}
+
+static const char *const bmp_extns[] = { ".bmp", NULL };
+
+/* BMP stores its pixel rows as raw bytes */
+const CoverFormat bmp_format =
+{
+    .name = "bmp",
+    .extns = bmp_extns,
+    .default_stego_fname = "stego.bmp",
+    .raw_layout = 1,
+    .parse_header = parse_bmp_header,
+    .begin_span = raw_begin_span,
+    .read_channels = raw_read_channels,
+    .write_channels = raw_write_channels,
+    .end_span = raw_end_span,
+    .release = raw_release,
+};
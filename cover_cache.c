@@ -0,0 +1,353 @@
+/* This file contains codes related to the cover image cache */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "cover_cache.h"
+#include "types.h"
+
+/* Function Definitions */
+
+/* Unlink an entry from the LRU list */
+static void cache_unlink(CoverCache *cache, CoverCacheEntry *entry)
+{
+    if(entry->prev != NULL)
+        entry->prev->next = entry->next;
+    else
+        cache->head = entry->next;
+
+    if(entry->next != NULL)
+        entry->next->prev = entry->prev;
+    else
+        cache->tail = entry->prev;
+
+    entry->prev = entry->next = NULL;
+}
+
+/* Put an entry in front of the LRU list */
+static void cache_push_front(CoverCache *cache, CoverCacheEntry *entry)
+{
+    entry->prev = NULL;
+    entry->next = cache->head;
+    if(cache->head != NULL)
+        cache->head->prev = entry;
+    else
+        cache->tail = entry;
+    cache->head = entry;
+}
+
+/* Free the files known to hold an entry */
+static void cache_free_files(CoverCacheEntry *entry)
+{
+    while(entry->files != NULL)
+    {
+        CoverCacheFile *file = entry->files;
+
+        entry->files = file->next;
+        free(file);
+    }
+}
+
+/* Take an entry out of the cache, it is freed once no job references it */
+static void cache_remove(CoverCache *cache, CoverCacheEntry *entry)
+{
+    cache_unlink(cache, entry);
+    cache_free_files(entry);
+    cache->bytes -= entry->size;
+    cache->entries--;
+
+    if(entry->refs == 0)
+    {
+        free(entry->data);
+        free(entry);
+    }
+    else
+    {
+        entry->stale = 1;
+    }
+}
+
+/* Evict least recently used entries until the cache fits its bound */
+static void cache_evict(CoverCache *cache)
+{
+    CoverCacheEntry *entry = cache->tail;
+
+    while(cache->bytes > cache->max_bytes && entry != NULL)
+    {
+        CoverCacheEntry *prev = entry->prev;
+
+        cache_remove(cache, entry);
+        cache->evictions++;
+        entry = prev;
+    }
+}
+
+/* Read the whole file behind fd */
+static char *cache_read_file(int fd, off_t size)
+{
+    char *data = malloc(size);
+    off_t done = 0;
+
+    while(data != NULL && done < size)
+    {
+        ssize_t n = pread(fd, data + done, size - done, done);
+
+        if(n <= 0)
+        {
+            free(data);
+            return NULL;
+        }
+        done += n;
+    }
+
+    return data;
+}
+
+/* Content hash, 8 bytes per step with a multiply and shift mix */
+static unsigned long long cache_hash(const char *data, off_t size)
+{
+    unsigned long long hash = 0x9E3779B97F4A7C15ULL ^ (unsigned long long) size;
+    unsigned long long word;
+    off_t i = 0;
+
+    for(; i + 8 <= size; i += 8)
+    {
+        memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCDULL;
+        hash ^= hash >> 32;
+    }
+
+    /* Tail bytes */
+    word = 0;
+    memcpy(&word, data + i, size - i);
+    hash = (hash ^ word) * 0xC4CEB9FE1A85EC53ULL;
+
+    return hash ^ (hash >> 29);
+}
+
+/* Find the entry a file was last seen holding */
+static CoverCacheEntry *cache_find_file(CoverCache *cache, const struct stat *st, CoverCacheFile ***link)
+{
+    for(CoverCacheEntry *entry = cache->head; entry != NULL; entry = entry->next)
+    {
+        for(CoverCacheFile **file = &entry->files; *file != NULL; file = &(*file)->next)
+        {
+            if((*file)->dev == st->st_dev && (*file)->ino == st->st_ino)
+            {
+                *link = file;
+                return entry;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/* Forget what a file was last seen holding */
+static void cache_drop_file(CoverCache *cache, const struct stat *st)
+{
+    CoverCacheFile **link;
+
+    if(cache_find_file(cache, st, &link) != NULL)
+    {
+        CoverCacheFile *file = *link;
+
+        *link = file->next;
+        free(file);
+    }
+}
+
+/* Find an entry by content */
+static CoverCacheEntry *cache_find_content(CoverCache *cache, unsigned long long hash, const char *data, off_t size)
+{
+    for(CoverCacheEntry *entry = cache->head; entry != NULL; entry = entry->next)
+    {
+        if(entry->hash == hash && entry->size == size && memcmp(entry->data, data, size) == 0)
+        {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+/* Function definition to set up an empty cache */
+Status cover_cache_init(CoverCache *cache, size_t max_bytes)
+{
+    memset(cache, 0, sizeof (CoverCache));
+    cache->max_bytes = max_bytes;
+
+    return pthread_mutex_init(&cache->lock, NULL) == 0 ? e_success : e_failure;
+}
+
+/*
+ * Get the cover behind fd
+ * Input: Open cover file
+ * Output: Referenced cache entry, NULL when the file is not cached
+ * Description: A file seen before with the same size and mtime is
+ * a hit without any read. Otherwise the file is read and hashed, and
+ * content cached under another file, such as a copy or a memfd of
+ * the same cover, is shared instead of stored twice.
+ */
+CoverCacheEntry *cover_cache_get(CoverCache *cache, int fd)
+{
+    CoverCacheEntry *entry, *other;
+    CoverCacheFile **link, *file;
+    unsigned long long hash;
+    struct stat st;
+    char *data;
+
+    if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0 || (size_t) st.st_size > cache->max_bytes)
+    {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    entry = cache_find_file(cache, &st, &link);
+
+    /* Known file with the same size and mtime, nothing to read */
+    if(entry != NULL && (*link)->size == st.st_size &&
+       (*link)->mtime.tv_sec == st.st_mtim.tv_sec && (*link)->mtime.tv_nsec == st.st_mtim.tv_nsec)
+    {
+        cache_unlink(cache, entry);
+        cache_push_front(cache, entry);
+        entry->refs++;
+        cache->hits++;
+        pthread_mutex_unlock(&cache->lock);
+        return entry;
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    /* Read and hash outside the lock so other jobs are not held up by the disk */
+    file = calloc(1, sizeof (CoverCacheFile));
+    data = file != NULL ? cache_read_file(fd, st.st_size) : NULL;
+    if(data == NULL)
+    {
+        free(file);
+        return NULL;
+    }
+    hash = cache_hash(data, st.st_size);
+    file->dev = st.st_dev;
+    file->ino = st.st_ino;
+    file->size = st.st_size;
+    file->mtime = st.st_mtim;
+
+    /* A changed file no longer holds its old content, which may still be used by other files */
+    pthread_mutex_lock(&cache->lock);
+    cache_drop_file(cache, &st);
+
+    /* Same content under another file, or cached by another job meanwhile */
+    other = cache_find_content(cache, hash, data, st.st_size);
+    if(other != NULL)
+    {
+        file->next = other->files;
+        other->files = file;
+        cache_unlink(cache, other);
+        cache_push_front(cache, other);
+        other->refs++;
+        cache->dedups++;
+        pthread_mutex_unlock(&cache->lock);
+        free(data);
+        return other;
+    }
+    cache->misses++;
+
+    entry = calloc(1, sizeof (CoverCacheEntry));
+    if(entry == NULL)
+    {
+        pthread_mutex_unlock(&cache->lock);
+        free(file);
+        free(data);
+        return NULL;
+    }
+    entry->hash = hash;
+    entry->size = st.st_size;
+    entry->data = data;
+    entry->files = file;
+    entry->refs = 1;
+
+    cache_push_front(cache, entry);
+    cache->bytes += entry->size;
+    cache->entries++;
+    cache_evict(cache);
+    pthread_mutex_unlock(&cache->lock);
+
+    return entry;
+}
+
+/*
+ * Parsed header of an entry
+ * Input: Referenced entry and the format of the cover file name
+ * Output: Header kept with the entry, NULL on a parse failure or
+ * when the content was parsed as another format
+ * Description: The header is parsed once from the cached bytes, so
+ * later encodes with the same cover skip parsing. It is never
+ * changed after that and stays valid while the entry is referenced.
+ */
+const CoverInfo *cover_cache_header(CoverCache *cache, CoverCacheEntry *entry, const CoverFormat *format)
+{
+    const CoverInfo *header = NULL;
+    CoverInfo cover;
+    FILE *fptr;
+    Status ret;
+
+    pthread_mutex_lock(&cache->lock);
+    if(entry->header.format != NULL)
+    {
+        header = entry->header.format == format ? &entry->header : NULL;
+        pthread_mutex_unlock(&cache->lock);
+        return header;
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    fptr = fmemopen(entry->data, entry->size, "r");
+    if(fptr == NULL)
+    {
+        return NULL;
+    }
+    ret = cover_parse_header(format, fptr, &cover);
+    cover_release(&cover);
+    fclose(fptr);
+    if(ret == e_failure)
+    {
+        return NULL;
+    }
+
+    /* Parsed by another job meanwhile, possibly as another format */
+    pthread_mutex_lock(&cache->lock);
+    if(entry->header.format == NULL)
+    {
+        entry->header = cover;
+    }
+    header = entry->header.format == format ? &entry->header : NULL;
+    pthread_mutex_unlock(&cache->lock);
+
+    return header;
+}
+
+/* Function definition to drop a reference */
+void cover_cache_put(CoverCache *cache, CoverCacheEntry *entry)
+{
+    pthread_mutex_lock(&cache->lock);
+    entry->refs--;
+
+    /* Removed while in use, free it now */
+    if(entry->refs == 0 && entry->stale)
+    {
+        free(entry->data);
+        free(entry);
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+/* Function definition to free every entry */
+void cover_cache_destroy(CoverCache *cache)
+{
+    while(cache->head != NULL)
+    {
+        cache_remove(cache, cache->head);
+    }
+    pthread_mutex_destroy(&cache->lock);
+}
@@ -0,0 +1,85 @@
+/* This file contains the function prototypes and structs for the cover image cache */
+
+#ifndef COVER_CACHE_H
+#define COVER_CACHE_H
+
+#include <stdio.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <time.h>
+#include "types.h" // Contains user defined types
+#include "cover.h" // Contains the cover format layer
+
+/* A file known to hold the content of an entry */
+typedef struct _CoverCacheFile
+{
+    /* File identity, a changed size or mtime makes it stale */
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+
+    struct _CoverCacheFile *next;
+
+} CoverCacheFile;
+
+/* One cached cover, identified by its content */
+typedef struct _CoverCacheEntry
+{
+    /* Content address, equal hashes are confirmed byte by byte */
+    unsigned long long hash;
+    off_t size;
+
+    /* Whole cover file */
+    char *data;
+
+    /* Files holding this content, looked up before any read */
+    CoverCacheFile *files;
+
+    /* Header parsed on first use, format is NULL until then */
+    CoverInfo header;
+
+    /* Jobs still reading data */
+    uint refs;
+    int stale;
+
+    /* LRU list, most recently used first */
+    struct _CoverCacheEntry *prev;
+    struct _CoverCacheEntry *next;
+
+} CoverCacheEntry;
+
+/* Size bounded LRU cache of cover images */
+typedef struct _CoverCache
+{
+    pthread_mutex_t lock;
+    CoverCacheEntry *head;
+    CoverCacheEntry *tail;
+    size_t bytes;
+    size_t max_bytes;
+    uint entries;
+
+    /* Counters for the stats output */
+    unsigned long hits;         // Known file, no read
+    unsigned long dedups;       // Read, but the content was cached under another file
+    unsigned long misses;
+    unsigned long evictions;
+
+} CoverCache;
+
+/* Set up an empty cache holding up to max_bytes of covers */
+Status cover_cache_init(CoverCache *cache, size_t max_bytes);
+
+/* Get the cover behind fd, reading it on a miss. The entry stays referenced until put back */
+CoverCacheEntry *cover_cache_get(CoverCache *cache, int fd);
+
+/* Parsed header of an entry, NULL when it is not a cover of that format */
+const CoverInfo *cover_cache_header(CoverCache *cache, CoverCacheEntry *entry, const CoverFormat *format);
+
+/* Drop a reference taken by cover_cache_get */
+void cover_cache_put(CoverCache *cache, CoverCacheEntry *entry);
+
+/* Free every entry */
+void cover_cache_destroy(CoverCache *cache);
+
+#endif
@@ -0,0 +1,625 @@
+/* This file contains the lossless PNG cover format */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include "cover.h"
+#include "types.h"
+
+#define PNG_SIGNATURE_SIZE 8
+#define PNG_CHUNK_HEADER_SIZE 8
+#define PNG_CHUNK_CRC_SIZE 4
+#define PNG_IHDR_SIZE 13
+#define PNG_IO_BUF_SIZE 32768
+#define PNG_MAX_DIMENSION 1000000    // Same default limit as libpng, the span is not bounded by the file length
+
+/* PNG scanline filter types */
+#define PNG_FILTER_NONE 0
+#define PNG_FILTER_SUB 1
+#define PNG_FILTER_UP 2
+#define PNG_FILTER_AVERAGE 3
+#define PNG_FILTER_PAETH 4
+#define PNG_FILTER_COUNT 5
+
+static const unsigned char png_signature[PNG_SIGNATURE_SIZE] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+/*
+ * Streaming state of a PNG cover.
+ * Only two scanlines are kept on the reading side (the row
+ * being handed out and the previous one to undo the filters),
+ * and four on the writing side (the previous and current raw
+ * rows, plus two to pick the cheapest filter). Together with
+ * the zlib windows this bounds memory regardless of image size.
+ */
+typedef struct _PngStream
+{
+    uint bpp;                   // Bytes per complete pixel, used by the filters
+    uint row_bytes;             // Channel bytes per scanline, without the filter byte
+
+    /* Reading side, inflate IDAT data and undo the filters */
+    z_stream inflater;
+    int inflater_ready;
+    uint idat_left;             // Bytes left in the current IDAT chunk
+    unsigned char *in_prev;     // Filter byte followed by the previous raw row
+    unsigned char *in_row;      // Filter byte followed by the current raw row
+    uint in_pos;                // Next channel of in_row to hand out
+    unsigned char in_buf[PNG_IO_BUF_SIZE];
+
+    /* Block holding all six scanlines */
+    unsigned char *rows;
+
+    /* Writing side, filter the rows again and deflate them into IDAT chunks */
+    z_stream deflater;
+    int deflater_ready;
+    unsigned char *out_prev;
+    unsigned char *out_row;
+    unsigned char *out_try;
+    unsigned char *out_best;
+    uint out_pos;
+    uint out_fill;              // Compressed bytes waiting in out_buf
+    unsigned char out_buf[PNG_IO_BUF_SIZE];
+
+} PngStream;
+
+/* Read a big endian 32 bit value */
+static uint png_be32(const unsigned char *buf)
+{
+    return ((uint) buf[0] << 24) | ((uint) buf[1] << 16) | ((uint) buf[2] << 8) | buf[3];
+}
+
+/* Store a big endian 32 bit value */
+static void png_put_be32(unsigned char *buf, uint value)
+{
+    buf[0] = value >> 24;
+    buf[1] = value >> 16;
+    buf[2] = value >> 8;
+    buf[3] = value;
+}
+
+/* Paeth predictor from the PNG specification */
+static unsigned char png_paeth(int a, int b, int c)
+{
+    int p = a + b - c;
+    int pa = abs(p - a);
+    int pb = abs(p - b);
+    int pc = abs(p - c);
+
+    if(pa <= pb && pa <= pc)
+    {
+        return a;
+    }
+    return pb <= pc ? b : c;
+}
+
+/* Undo the filter of one scanline in place, prev is the previous raw scanline */
+static Status png_unfilter_row(int filter, unsigned char *row, const unsigned char *prev, uint len, uint bpp)
+{
+    uint i;
+
+    switch(filter)
+    {
+        case PNG_FILTER_NONE:
+            break;
+        case PNG_FILTER_SUB:
+            for(i = bpp; i < len; i++)
+                row[i] += row[i - bpp];
+            break;
+        case PNG_FILTER_UP:
+            for(i = 0; i < len; i++)
+                row[i] += prev[i];
+            break;
+        case PNG_FILTER_AVERAGE:
+            for(i = 0; i < bpp; i++)
+                row[i] += prev[i] >> 1;
+            for(; i < len; i++)
+                row[i] += (row[i - bpp] + prev[i]) >> 1;
+            break;
+        case PNG_FILTER_PAETH:
+            for(i = 0; i < bpp; i++)
+                row[i] += prev[i];
+            for(; i < len; i++)
+                row[i] += png_paeth(row[i - bpp], prev[i], prev[i - bpp]);
+            break;
+        default:
+            return e_failure;
+    }
+
+    return e_success;
+}
+
+/* Filter one raw scanline into out, prev is the previous raw scanline */
+static void png_filter_row(int filter, unsigned char *out, const unsigned char *row, const unsigned char *prev, uint len, uint bpp)
+{
+    uint i;
+
+    for(i = 0; i < len; i++)
+    {
+        int a = i >= bpp ? row[i - bpp] : 0;
+        int c = i >= bpp ? prev[i - bpp] : 0;
+
+        switch(filter)
+        {
+            case PNG_FILTER_SUB:
+                out[i] = row[i] - a;
+                break;
+            case PNG_FILTER_UP:
+                out[i] = row[i] - prev[i];
+                break;
+            case PNG_FILTER_AVERAGE:
+                out[i] = row[i] - ((a + prev[i]) >> 1);
+                break;
+            case PNG_FILTER_PAETH:
+                out[i] = row[i] - png_paeth(a, prev[i], c);
+                break;
+            default:
+                out[i] = row[i];
+                break;
+        }
+    }
+}
+
+/*
+ * Parse PNG header
+ * Input: Image file ptr
+ * Output: width, height and pixel span of the image
+ * Description: The 8 byte signature is followed by the IHDR chunk,
+ * holding width and height (4 bytes each, big endian), bit depth,
+ * color type, compression, filter and interlace method.
+ * Only non interlaced 8 bit gray, gray+alpha, RGB and RGBA images
+ * are accepted, palette indices are not suitable for LSB embedding.
+ */
+static Status parse_png_header(FILE *fptr_image, CoverInfo *cover)
+{
+    unsigned char header[PNG_SIGNATURE_SIZE + PNG_CHUNK_HEADER_SIZE + PNG_IHDR_SIZE];
+    const unsigned char *ihdr = header + PNG_SIGNATURE_SIZE + PNG_CHUNK_HEADER_SIZE;
+
+    if(fread(header, 1, sizeof (header), fptr_image) != sizeof (header))
+    {
+        return e_failure;
+    }
+
+    if(memcmp(header, png_signature, PNG_SIGNATURE_SIZE) != 0 ||
+       png_be32(header + PNG_SIGNATURE_SIZE) != PNG_IHDR_SIZE ||
+       memcmp(header + PNG_SIGNATURE_SIZE + 4, "IHDR", 4) != 0)
+    {
+        return e_failure;
+    }
+
+    /* 8 bit depth, deflate compression, adaptive filtering, no interlace */
+    if(ihdr[8] != 8 || ihdr[10] != 0 || ihdr[11] != 0 || ihdr[12] != 0)
+    {
+        return e_failure;
+    }
+
+    switch(ihdr[9])
+    {
+        case 0: cover->channels = 1; break;     // Gray
+        case 2: cover->channels = 3; break;     // RGB
+        case 4: cover->channels = 2; break;     // Gray + alpha
+        case 6: cover->channels = 4; break;     // RGBA
+        default: return e_failure;
+    }
+
+    cover->width = png_be32(ihdr);
+    cover->height = png_be32(ihdr + 4);
+    if(cover->width == 0 || cover->height == 0 || cover->width > PNG_MAX_DIMENSION || cover->height > PNG_MAX_DIMENSION)
+    {
+        return e_failure;
+    }
+
+    cover->row_stride = cover->width * cover->channels;
+    cover->pixel_offset = PNG_SIGNATURE_SIZE;
+    cover->pixel_span = cover->row_stride * cover->height;
+
+    return e_success;
+}
+
+/* Write a chunk with its length and CRC */
+static Status png_write_chunk(FILE *fptr, const char *type, const unsigned char *data, uint len)
+{
+    unsigned char buf[4];
+    uLong crc = crc32(0L, (const Bytef *) type, 4);
+
+    crc = crc32(crc, data, len);
+
+    png_put_be32(buf, len);
+    if(fwrite(buf, 1, 4, fptr) != 4 || fwrite(type, 1, 4, fptr) != 4 || fwrite(data, 1, len, fptr) != len)
+    {
+        return e_failure;
+    }
+    png_put_be32(buf, crc);
+
+    return fwrite(buf, 1, 4, fptr) == 4 ? e_success : e_failure;
+}
+
+/* Copy or skip len bytes of src */
+static Status png_pass_bytes(FILE *src, FILE *dest, long len)
+{
+    char buf[COVER_COPY_BUF_SIZE];
+
+    if(dest == NULL)
+    {
+        return fseek(src, len, SEEK_CUR) == 0 ? e_success : e_failure;
+    }
+
+    while(len > 0)
+    {
+        size_t n = len < COVER_COPY_BUF_SIZE ? len : COVER_COPY_BUF_SIZE;
+
+        if(fread(buf, 1, n, src) != n || fwrite(buf, 1, n, dest) != n)
+        {
+            return e_failure;
+        }
+        len -= n;
+    }
+
+    return e_success;
+}
+
+/* Move to the next IDAT chunk, the CRC of the current one is still pending */
+static Status png_next_idat(PngStream *png, FILE *src)
+{
+    unsigned char head[PNG_CHUNK_HEADER_SIZE];
+
+    if(png_pass_bytes(src, NULL, PNG_CHUNK_CRC_SIZE) == e_failure ||
+       fread(head, 1, PNG_CHUNK_HEADER_SIZE, src) != PNG_CHUNK_HEADER_SIZE ||
+       memcmp(head + 4, "IDAT", 4) != 0)
+    {
+        return e_failure;
+    }
+    png->idat_left = png_be32(head);
+
+    return e_success;
+}
+
+/* Inflate and unfilter the next scanline into in_row */
+static Status png_read_row(PngStream *png, FILE *src)
+{
+    unsigned char *row = png->in_prev;
+    int ret;
+
+    /* The current row becomes the previous one */
+    png->in_prev = png->in_row;
+    png->in_row = row;
+
+    png->inflater.next_out = row;
+    png->inflater.avail_out = png->row_bytes + 1;
+
+    while(png->inflater.avail_out > 0)
+    {
+        if(png->inflater.avail_in == 0)
+        {
+            uint n;
+
+            while(png->idat_left == 0)
+            {
+                if(png_next_idat(png, src) == e_failure)
+                {
+                    return e_failure;
+                }
+            }
+
+            n = png->idat_left < PNG_IO_BUF_SIZE ? png->idat_left : PNG_IO_BUF_SIZE;
+            if(fread(png->in_buf, 1, n, src) != n)
+            {
+                return e_failure;
+            }
+            png->idat_left -= n;
+            png->inflater.next_in = png->in_buf;
+            png->inflater.avail_in = n;
+        }
+
+        ret = inflate(&png->inflater, Z_NO_FLUSH);
+        if(ret == Z_STREAM_END && png->inflater.avail_out > 0)
+        {
+            return e_failure;
+        }
+        if(ret != Z_OK && ret != Z_STREAM_END)
+        {
+            return e_failure;
+        }
+    }
+
+    png->in_pos = 0;
+
+    return png_unfilter_row(row[0], row + 1, png->in_prev + 1, png->row_bytes, png->bpp);
+}
+
+/* Deflate data into IDAT chunks of dest */
+static Status png_deflate(PngStream *png, FILE *dest, unsigned char *data, uint len, int flush)
+{
+    int ret;
+
+    png->deflater.next_in = data;
+    png->deflater.avail_in = len;
+
+    do
+    {
+        png->deflater.next_out = png->out_buf + png->out_fill;
+        png->deflater.avail_out = PNG_IO_BUF_SIZE - png->out_fill;
+
+        ret = deflate(&png->deflater, flush);
+        if(ret == Z_STREAM_ERROR)
+        {
+            return e_failure;
+        }
+        png->out_fill = PNG_IO_BUF_SIZE - png->deflater.avail_out;
+
+        /* Emit a chunk whenever the buffer fills up */
+        if(png->out_fill == PNG_IO_BUF_SIZE)
+        {
+            if(png_write_chunk(dest, "IDAT", png->out_buf, png->out_fill) == e_failure)
+            {
+                return e_failure;
+            }
+            png->out_fill = 0;
+        }
+    } while(png->deflater.avail_in > 0 || (flush == Z_FINISH && ret != Z_STREAM_END));
+
+    if(flush == Z_FINISH && png->out_fill > 0)
+    {
+        if(png_write_chunk(dest, "IDAT", png->out_buf, png->out_fill) == e_failure)
+        {
+            return e_failure;
+        }
+        png->out_fill = 0;
+    }
+
+    return e_success;
+}
+
+/* Filter the completed out_row with the cheapest filter and deflate it */
+static Status png_write_row(PngStream *png, FILE *dest)
+{
+    unsigned long best_cost = (unsigned long) -1;
+    unsigned char *row = png->out_row;
+
+    /* Minimum sum of absolute differences heuristic, as recommended by the PNG specification */
+    for(int filter = PNG_FILTER_NONE; filter < PNG_FILTER_COUNT; filter++)
+    {
+        unsigned long cost = 0;
+
+        png_filter_row(filter, png->out_try + 1, row + 1, png->out_prev + 1, png->row_bytes, png->bpp);
+        for(uint i = 1; i <= png->row_bytes; i++)
+        {
+            cost += png->out_try[i] < 128 ? png->out_try[i] : 256 - png->out_try[i];
+        }
+
+        if(cost < best_cost)
+        {
+            unsigned char *swap = png->out_best;
+
+            png->out_best = png->out_try;
+            png->out_try = swap;
+            png->out_best[0] = filter;
+            best_cost = cost;
+        }
+    }
+
+    /* The current row becomes the previous one */
+    png->out_row = png->out_prev;
+    png->out_prev = row;
+    png->out_pos = 0;
+
+    return png_deflate(png, dest, png->out_best, png->row_bytes + 1, Z_NO_FLUSH);
+}
+
+/* Allocate the streaming state and its scanline buffers */
+static PngStream *png_stream_new(CoverInfo *cover)
+{
+    uint row_size = cover->row_stride + 1;
+    PngStream *png = calloc(1, sizeof (PngStream));
+    unsigned char *rows = calloc(6, row_size);
+
+    if(png == NULL || rows == NULL)
+    {
+        free(png);
+        free(rows);
+        return NULL;
+    }
+
+    png->rows = rows;
+    png->bpp = cover->channels;
+    png->row_bytes = cover->row_stride;
+    png->in_prev = rows;
+    png->in_row = rows + row_size;
+    png->out_prev = rows + 2 * row_size;
+    png->out_row = rows + 3 * row_size;
+    png->out_try = rows + 4 * row_size;
+    png->out_best = rows + 5 * row_size;
+
+    /* No row has been inflated yet */
+    png->in_pos = png->row_bytes;
+
+    return png;
+}
+
+/* Function definition to copy or skip the chunks before the first IDAT and set up the streams */
+static Status png_begin_span(FILE *src, FILE *dest, CoverInfo *cover)
+{
+    unsigned char head[PNG_CHUNK_HEADER_SIZE];
+    PngStream *png = png_stream_new(cover);
+
+    if(png == NULL)
+    {
+        return e_failure;
+    }
+    cover->priv = png;
+
+    fseek(src, PNG_SIGNATURE_SIZE, SEEK_SET);
+    if(dest != NULL && fwrite(png_signature, 1, PNG_SIGNATURE_SIZE, dest) != PNG_SIGNATURE_SIZE)
+    {
+        return e_failure;
+    }
+
+    /* Pass every chunk up to the first IDAT as it is */
+    while(1)
+    {
+        if(fread(head, 1, PNG_CHUNK_HEADER_SIZE, src) != PNG_CHUNK_HEADER_SIZE)
+        {
+            return e_failure;
+        }
+        if(memcmp(head + 4, "IDAT", 4) == 0)
+        {
+            png->idat_left = png_be32(head);
+            break;
+        }
+        if(dest != NULL && fwrite(head, 1, PNG_CHUNK_HEADER_SIZE, dest) != PNG_CHUNK_HEADER_SIZE)
+        {
+            return e_failure;
+        }
+        if(png_pass_bytes(src, dest, (long) png_be32(head) + PNG_CHUNK_CRC_SIZE) == e_failure)
+        {
+            return e_failure;
+        }
+    }
+
+    if(inflateInit(&png->inflater) != Z_OK)
+    {
+        return e_failure;
+    }
+    png->inflater_ready = 1;
+
+    if(dest != NULL)
+    {
+        if(deflateInit(&png->deflater, Z_DEFAULT_COMPRESSION) != Z_OK)
+        {
+            return e_failure;
+        }
+        png->deflater_ready = 1;
+    }
+
+    return e_success;
+}
+
+/* Function definition to hand out unfiltered channel bytes */
+static uint png_read_channels(CoverInfo *cover, FILE *fptr, char *buf, uint n)
+{
+    PngStream *png = cover->priv;
+    uint done = 0;
+
+    while(done < n)
+    {
+        uint len;
+
+        if(png->in_pos == png->row_bytes && png_read_row(png, fptr) == e_failure)
+        {
+            break;
+        }
+
+        len = png->row_bytes - png->in_pos;
+        if(len > n - done)
+        {
+            len = n - done;
+        }
+        memcpy(buf + done, png->in_row + 1 + png->in_pos, len);
+        png->in_pos += len;
+        done += len;
+    }
+
+    return done;
+}
+
+/* Function definition to take channel bytes back and compress every completed row */
+static uint png_write_channels(CoverInfo *cover, FILE *fptr, const char *buf, uint n)
+{
+    PngStream *png = cover->priv;
+    uint done = 0;
+
+    while(done < n)
+    {
+        uint len = png->row_bytes - png->out_pos;
+
+        if(len > n - done)
+        {
+            len = n - done;
+        }
+        memcpy(png->out_row + 1 + png->out_pos, buf + done, len);
+        png->out_pos += len;
+        done += len;
+
+        /* A row that can not be written is not counted, so the caller sees a short write */
+        if(png->out_pos == png->row_bytes && png_write_row(png, fptr) == e_failure)
+        {
+            done -= len;
+            break;
+        }
+    }
+
+    return done;
+}
+
+/* Function definition to finish the IDAT stream and copy the chunks after it */
+static Status png_end_span(FILE *src, FILE *dest, CoverInfo *cover)
+{
+    PngStream *png = cover->priv;
+    unsigned char head[PNG_CHUNK_HEADER_SIZE];
+
+    if(png_deflate(png, dest, NULL, 0, Z_FINISH) == e_failure)
+    {
+        return e_failure;
+    }
+
+    /* Skip whatever is left of the source IDAT chunks */
+    if(png_pass_bytes(src, NULL, (long) png->idat_left + PNG_CHUNK_CRC_SIZE) == e_failure)
+    {
+        return e_failure;
+    }
+    while(fread(head, 1, PNG_CHUNK_HEADER_SIZE, src) == PNG_CHUNK_HEADER_SIZE && memcmp(head + 4, "IDAT", 4) == 0)
+    {
+        if(png_pass_bytes(src, NULL, (long) png_be32(head) + PNG_CHUNK_CRC_SIZE) == e_failure)
+        {
+            return e_failure;
+        }
+    }
+
+    /* Copy the remaining chunks, IEND included */
+    if(feof(src) || fwrite(head, 1, PNG_CHUNK_HEADER_SIZE, dest) != PNG_CHUNK_HEADER_SIZE)
+    {
+        return e_failure;
+    }
+
+    return raw_end_span(src, dest, cover);
+}
+
+/* Function definition to release the streaming state */
+static void png_release(CoverInfo *cover)
+{
+    PngStream *png = cover->priv;
+
+    if(png == NULL)
+    {
+        return;
+    }
+
+    if(png->inflater_ready)
+    {
+        inflateEnd(&png->inflater);
+    }
+    if(png->deflater_ready)
+    {
+        deflateEnd(&png->deflater);
+    }
+
+    free(png->rows);
+    free(png);
+
+    cover->priv = NULL;
+}
+
+static const char *const png_extns[] = { ".png", NULL };
+
+/* PNG streams deflated, filtered scanlines */
+const CoverFormat png_format =
+{
+    .name = "png",
+    .extns = png_extns,
+    .default_stego_fname = "stego.png",
+    .parse_header = parse_png_header,
+    .begin_span = png_begin_span,
+    .read_channels = png_read_channels,
+    .write_channels = png_write_channels,
+    .end_span = png_end_span,
+    .release = png_release,
+};
@@ -0,0 +1,120 @@
+/* This file contains the PPM/PGM cover format */
+
+#include <stdio.h>
+#include <ctype.h>
+#include <limits.h>
+#include "cover.h"
+#include "types.h"
+
+/* Read the next unsigned number of a netpbm header, skipping whitespace and comments */
+static Status ppm_read_number(FILE *fptr, uint *value)
+{
+    int ch = fgetc(fptr);
+
+    /* Skip whitespace and comment lines */
+    while(ch == '#' || isspace(ch))
+    {
+        if(ch == '#')
+        {
+            while(ch != '\n' && ch != EOF)
+            {
+                ch = fgetc(fptr);
+            }
+        }
+        ch = fgetc(fptr);
+    }
+
+    if(!isdigit(ch))
+    {
+        return e_failure;
+    }
+
+    *value = 0;
+    while(isdigit(ch))
+    {
+        /* Numbers beyond 32 bits are not images */
+        if(*value > (UINT_MAX - 9) / 10)
+        {
+            return e_failure;
+        }
+        *value = *value * 10 + (ch - '0');
+        ch = fgetc(fptr);
+    }
+
+    /* A single whitespace character ends the number */
+    if(!isspace(ch))
+    {
+        return e_failure;
+    }
+
+    return e_success;
+}
+
+/*
+ * Parse PPM/PGM header
+ * Input: Image file ptr
+ * Output: width, height and pixel span of the image
+ * Description: Binary netpbm files start with P6 (RGB) or P5 (gray),
+ * followed by width, height and maxval as decimal text. Pixel data
+ * starts right after the single whitespace following maxval.
+ * Only 8 bit samples (maxval <= 255) are accepted.
+ */
+static Status parse_ppm_header(FILE *fptr_image, CoverInfo *cover)
+{
+    char magic[2];
+    uint maxval;
+
+    if(fread(magic, 1, 2, fptr_image) != 2 || magic[0] != 'P')
+    {
+        return e_failure;
+    }
+
+    /* P6 has 3 channels, P5 has 1 */
+    if(magic[1] == '6')
+    {
+        cover->channels = 3;
+    }
+    else if(magic[1] == '5')
+    {
+        cover->channels = 1;
+    }
+    else
+    {
+        return e_failure;
+    }
+
+    if(ppm_read_number(fptr_image, &cover->width) == e_failure ||
+       ppm_read_number(fptr_image, &cover->height) == e_failure ||
+       ppm_read_number(fptr_image, &maxval) == e_failure)
+    {
+        return e_failure;
+    }
+
+    if(maxval == 0 || maxval > 255)
+    {
+        return e_failure;
+    }
+
+    cover->row_stride = cover->width * cover->channels;
+    cover->pixel_offset = ftell(fptr_image);
+    cover->pixel_span = cover->row_stride * cover->height;
+
+    return e_success;
+}
+
+static const char *const ppm_extns[] = { ".ppm", ".pgm", ".pnm", NULL };
+
+/* Netpbm stores its pixel rows as raw bytes */
+const CoverFormat ppm_format =
+{
+    .name = "ppm",
+    .extns = ppm_extns,
+    .default_stego_fname = "stego.ppm",
+    .raw_layout = 1,
+    .parse_header = parse_ppm_header,
+    .begin_span = raw_begin_span,
+    .read_channels = raw_read_channels,
+    .write_channels = raw_write_channels,
+    .end_span = raw_end_span,
+    .release = raw_release,
+};
@@ -0,0 +1,89 @@
+/* This file contains the uncompressed TGA cover format */
+
+#include <stdio.h>
+#include "cover.h"
+#include "types.h"
+
+/* TGA header offsets */
+#define TGA_HEADER_SIZE 18
+#define TGA_OFFSET_ID_LENGTH 0
+#define TGA_OFFSET_COLOR_MAP_TYPE 1
+#define TGA_OFFSET_IMAGE_TYPE 2
+#define TGA_OFFSET_WIDTH 12
+#define TGA_OFFSET_HEIGHT 14
+#define TGA_OFFSET_BITS_PER_PIXEL 16
+
+/* TGA image types */
+#define TGA_TYPE_TRUECOLOR 2
+#define TGA_TYPE_GRAYSCALE 3
+
+/*
+ * Parse TGA header
+ * Input: Image file ptr
+ * Output: width, height and pixel span of the image
+ * Description: The 18 byte TGA header is followed by an optional
+ * image id, then the pixel data. Only uncompressed true color
+ * (24/32 bit) and gray scale (8 bit) images without a color map
+ * are accepted. The footer of TGA 2.0 files is copied as it is.
+ */
+static Status parse_tga_header(FILE *fptr_image, CoverInfo *cover)
+{
+    unsigned char header[TGA_HEADER_SIZE];
+    uint bpp;
+
+    if(fread(header, 1, TGA_HEADER_SIZE, fptr_image) != TGA_HEADER_SIZE)
+    {
+        return e_failure;
+    }
+
+    if(header[TGA_OFFSET_COLOR_MAP_TYPE] != 0)
+    {
+        return e_failure;
+    }
+
+    bpp = header[TGA_OFFSET_BITS_PER_PIXEL];
+    if(header[TGA_OFFSET_IMAGE_TYPE] == TGA_TYPE_TRUECOLOR)
+    {
+        if(bpp != 24 && bpp != 32)
+        {
+            return e_failure;
+        }
+    }
+    else if(header[TGA_OFFSET_IMAGE_TYPE] == TGA_TYPE_GRAYSCALE)
+    {
+        if(bpp != 8)
+        {
+            return e_failure;
+        }
+    }
+    else
+    {
+        return e_failure;
+    }
+
+    cover->width = header[TGA_OFFSET_WIDTH] | (header[TGA_OFFSET_WIDTH + 1] << 8);
+    cover->height = header[TGA_OFFSET_HEIGHT] | (header[TGA_OFFSET_HEIGHT + 1] << 8);
+    cover->channels = bpp / 8;
+    cover->row_stride = cover->width * cover->channels;
+    cover->pixel_offset = TGA_HEADER_SIZE + header[TGA_OFFSET_ID_LENGTH];
+    cover->pixel_span = cover->row_stride * cover->height;
+
+    return e_success;
+}
+
+static const char *const tga_extns[] = { ".tga", NULL };
+
+/* Uncompressed TGA stores its pixel rows as raw bytes */
+const CoverFormat tga_format =
+{
+    .name = "tga",
+    .extns = tga_extns,
+    .default_stego_fname = "stego.tga",
+    .raw_layout = 1,
+    .parse_header = parse_tga_header,
+    .begin_span = raw_begin_span,
+    .read_channels = raw_read_channels,
+    .write_channels = raw_write_channels,
+    .end_span = raw_end_span,
+    .release = raw_release,
+};
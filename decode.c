@@ -1,17 +1,30 @@
 /* This file contains codes related to decoding */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "decode.h"
 #include "types.h"
 #include "common.h"
+#include "cover.h"
+#include "texture.h"
+#include "hamming.h"
+#include "kernels.h"
+#include "encode.h"
+#include "archive.h"
+#include <zlib.h>
 
 /* Function Definitions */
 /* Validating the files given through CLA */
 Status read_and_validate_decode_args(char *argv[], DecodeInfo *decInfo)
 {
-	/* Checking for stego image passed */
-    if(strcmp((strstr(argv[2],".")), ".bmp") == 0)
+	/* Checking for stego image of a supported format passed */
+    if(argv[2] == NULL)
+    {
+        return e_failure;
+    }
+    decInfo -> cover.format = cover_format_for_fname(argv[2]);
+    if(decInfo -> cover.format != NULL)
     {
         decInfo -> stego_image_fname = argv[2];
     }
@@ -20,11 +33,15 @@ Status read_and_validate_decode_args(char *argv[], DecodeInfo *decInfo)
         return e_failure;
     }
     
-	/* Checking if decode.txt given, if not assign by default */
+	/* Checking if decode.txt given, if not assign by default, an extracted member keeps its name */
     if(argv[3] != NULL)
     {
         decInfo -> decode_fname = argv[3];
     }
+    else if(decInfo -> extract_name != NULL)
+    {
+        decInfo -> decode_fname = (char *) decInfo -> extract_name;
+    }
     else
     {
         decInfo -> decode_fname = "decode.txt";
@@ -41,11 +58,14 @@ Status read_and_validate_decode_args(char *argv[], DecodeInfo *decInfo)
  * Return Value: e_success or e_failure, on file errors
  */
 
-/* Open stego image in read only mode and decode.txt in write only mode */
+/* Open stego image in read only mode and decode.txt in write only mode, files handed in by the caller are kept */
 Status open_decode_files(DecodeInfo *decInfo)
 {
     /* Stego Image file pointer */
-    decInfo->fptr_stego_image = fopen(decInfo->stego_image_fname, "r");
+    if(decInfo->fptr_stego_image == NULL)
+    {
+        decInfo->fptr_stego_image = fopen(decInfo->stego_image_fname, "r");
+    }
     
 	/* Do Error handling */
     if (decInfo->fptr_stego_image == NULL)
@@ -56,8 +76,17 @@ Status open_decode_files(DecodeInfo *decInfo)
     	return e_failure;
     }
 
+    /* Listing an archive writes no file, an extracted member is created once it is found */
+    if(decInfo->list_archive || decInfo->extract_name != NULL)
+    {
+        return e_success;
+    }
+
     /* decode.txt file pointer */
-    decInfo->fptr_decode_text = fopen(decInfo->decode_fname, "w");
+    if(decInfo->fptr_decode_text == NULL)
+    {
+        decInfo->fptr_decode_text = fopen(decInfo->decode_fname, "w");
+    }
     
 	/* Do Error handling */
     if (decInfo->fptr_decode_text == NULL)
@@ -72,6 +101,24 @@ Status open_decode_files(DecodeInfo *decInfo)
     return e_success;
 }
 
+/* Function definition to close the files and release the cover */
+void close_decode_files(DecodeInfo *decInfo)
+{
+    cover_release(&decInfo->cover);
+    archive_free(&decInfo->archive_index);
+
+    if(decInfo->fptr_stego_image != NULL)
+    {
+        fclose(decInfo->fptr_stego_image);
+        decInfo->fptr_stego_image = NULL;
+    }
+    if(decInfo->fptr_decode_text != NULL)
+    {
+        fclose(decInfo->fptr_decode_text);
+        decInfo->fptr_decode_text = NULL;
+    }
+}
+
 /* Function definition to fetch LSB bit from 8 bytes of stego image */
 Status decode_byte_from_lsb(char *ch, char *data_buffer)
 {
@@ -98,8 +145,11 @@ Status decode_data_from_image(const char *data, int size, FILE *fptr_stego_img,
 	/* Run loop until byte size reached */
     for(int i = 0; i < size; i++)
     {
-		/* Read bytes from stego image and pass to decode function */
-        fread(decInfo -> decode_data, 8, sizeof (char), decInfo -> fptr_stego_image);
+		/* Read bytes from stego image and pass to decode function, a short span fails */
+        if(cover_read_channels(&decInfo -> cover, decInfo -> fptr_stego_image, decInfo -> decode_data, 8) != 8)
+        {
+            return e_failure;
+        }
         decode_byte_from_lsb(&ch, decInfo -> decode_data);
         
         /* Failure if data is not matching return e_failure */
@@ -116,16 +166,79 @@ Status decode_data_from_image(const char *data, int size, FILE *fptr_stego_img,
 /* Function definition to decode the magic string  */
 Status decode_magic_string(const char *magic_string, DecodeInfo *decInfo)
 {
-	/* Place pointer to 54th position to skip the header file */
-    fseek(decInfo->fptr_stego_image, 54, SEEK_SET);
-    
-	/* Every decoding needs to call a function decode_data_from_image */
-	if(decode_data_from_image(magic_string, strlen(magic_string), decInfo->fptr_stego_image, decInfo) == e_failure)
+    char magic[sizeof (PARAM_MAGIC_STRING)] = { 0 };
+    uint len = strlen(magic_string);
+
+	/* Parse the stego image header and place pointer on the pixel span to skip the header */
+    if(len >= sizeof (magic) ||
+       cover_parse_header(decInfo->cover.format, decInfo->fptr_stego_image, &decInfo->cover) == e_failure ||
+       decInfo->cover.format->begin_span(decInfo->fptr_stego_image, NULL, &decInfo->cover) == e_failure)
+    {
+        return e_failure;
+    }
+
+    /* Read ahead with the engine when selected */
+    if(decInfo->io_backend == e_io_uring && cover_attach_io(&decInfo->cover, decInfo->fptr_stego_image, NULL) == e_failure)
     {
         return e_failure;
     }
     
-	/* No failure return e_success */
+	/* Decode as many bytes as the magic string holds */
+    for(uint i = 0; i < len; i++)
+    {
+        if(cover_read_channels(&decInfo -> cover, decInfo -> fptr_stego_image, decInfo -> decode_data, 8) != 8)
+        {
+            return e_failure;
+        }
+        decode_byte_from_lsb(&magic[i], decInfo -> decode_data);
+    }
+
+	/* The parameter magic string announces the parameter block */
+    decInfo->adaptive = 0;
+    decInfo->hamming_k = 0;
+    decInfo->archive = 0;
+    if(strcmp(magic, magic_string) == 0)
+    {
+        return e_success;
+    }
+    if(strlen(PARAM_MAGIC_STRING) == len && strcmp(magic, PARAM_MAGIC_STRING) == 0)
+    {
+        return decode_stego_params(decInfo);
+    }
+    
+    return e_failure;
+}
+
+/* Function definition to decode the parameter block */
+Status decode_stego_params(DecodeInfo *decInfo)
+{
+    char params[PARAM_BYTES];
+    uint flags;
+
+    for(int i = 0; i < PARAM_BYTES; i++)
+    {
+        if(cover_read_channels(&decInfo -> cover, decInfo -> fptr_stego_image, decInfo -> decode_data, 8) != 8)
+        {
+            return e_failure;
+        }
+        decode_byte_from_lsb(&params[i], decInfo -> decode_data);
+    }
+
+    flags = (unsigned char) params[0];
+    decInfo->adaptive = (flags & PARAM_ADAPTIVE) != 0;
+    decInfo->archive = (flags & PARAM_ARCHIVE) != 0;
+    decInfo->hamming_k = flags >> PARAM_HAMMING_SHIFT;
+    decInfo->texture_threshold = (unsigned char) params[1];
+
+	/* Unknown flags, a missing texture threshold, an unknown code or not exactly one layout mean another layout */
+    if((flags & PARAM_RESERVED) != 0 ||
+       (decInfo->adaptive && decInfo->texture_threshold == 0) ||
+       (decInfo->hamming_k != 0 && (decInfo->hamming_k < HAMMING_MIN_K || decInfo->hamming_k > HAMMING_MAX_K)) ||
+       decInfo->adaptive + (decInfo->hamming_k != 0) + decInfo->archive != 1)
+    {
+        return e_failure;
+    }
+
     return e_success;
 }
 
@@ -140,7 +253,7 @@ Status decode_size_from_lsb(char *buffer, long int *ch)
 		//data & 0x01 gives the LSB of the byte
 		//assign it to the MSB of a char variable at first iteration
 		//then keep assigning towards the LSB of the char variable during each loop
-        *ch |= ((buffer[i] & 0x01) << (31-i)) ;
+        *ch |= ((long) (buffer[i] & 0x01) << (31-i)) ;
     }
 	/* No failure return e_success */
     return e_success;
@@ -153,7 +266,10 @@ Status decode_size(int size, DecodeInfo *decInfo)
     long int ch;		//Variable to store the decoded data
 
 	/* Read size data from stego image and pass to decoding function */
-    fread(str,32,sizeof (char), decInfo->fptr_stego_image);
+    if(cover_read_channels(&decInfo->cover, decInfo->fptr_stego_image, str, 32) != 32)
+    {
+        return e_failure;
+    }
     decode_size_from_lsb(str, &ch);
     
 	/* Failure if size data is not matching return e_failure */
@@ -187,7 +303,10 @@ Status decode_secret_file_size(DecodeInfo *decInfo)
     long int ch;	//Variable to store the size data
 
 	/* Read the 4 bytes from stego image and pass it to the decoding function*/
-    fread(str, 32, sizeof (char), decInfo->fptr_stego_image);
+    if(cover_read_channels(&decInfo->cover, decInfo->fptr_stego_image, str, 32) != 32)
+    {
+        return e_failure;
+    }
     decode_size_from_lsb(str,&ch);
     
 	/* Store the file size to the struct variable */
@@ -198,19 +317,350 @@ Status decode_secret_file_size(DecodeInfo *decInfo)
     return e_success;
 }
 
+/* Function definition to fetch count bytes from the LSBs of 8 * count bytes, no checks inside */
+void decode_bytes_from_lsb(char *out, const char *data_buffer, uint count)
+{
+	/* The kernels for this CPU are picked at runtime */
+    lsb_kernels() -> extract(out, data_buffer, count);
+}
+
+/*
+ * Validate the decoded header against the stego image
+ * Description: The secret file size comes from the image and
+ * cannot be trusted. It must fit in what is left of the span in
+ * the layout the parameter block announced, which was itself
+ * checked against the real file length, so decoding the data
+ * never reads past the span.
+ */
+Status validate_secret_file_size(DecodeInfo *decInfo)
+{
+    unsigned long long bits = (unsigned long long) decInfo->decode_file_size * 8;
+    unsigned long long left = decInfo->cover.pixel_span - decInfo->cover.span_pos;
+
+	/* A span too small for the header leaves nothing */
+    if(decInfo->cover.span_pos > decInfo->cover.pixel_span)
+    {
+        return e_failure;
+    }
+
+	/* Adaptive layouts are checked against the texture map once it is built */
+    if(decInfo->adaptive)
+    {
+        return bits <= left ? e_success : e_failure;
+    }
+
+    if(decInfo->hamming_k != 0)
+    {
+        return (bits + decInfo->hamming_k - 1) / decInfo->hamming_k * HAMMING_GROUP_SIZE(decInfo->hamming_k) <= left ? e_success : e_failure;
+    }
+
+    return bits <= left ? e_success : e_failure;
+}
+
 /* Function definition related to decoding the secret data */
 Status decode_secret_file_data(DecodeInfo *decInfo)
 {
-    char ch;	//Variable to store each character
+    char buf[COVER_COPY_BUF_SIZE];
+    char out[COVER_COPY_BUF_SIZE / 8];
+    long left = decInfo -> decode_file_size;
     
-	/* Run loop until the size of secret file */
-    for(int i = 0; i < decInfo -> decode_file_size; i++)
+	/* The size was validated, so whole buffers are read and decoded without per byte checks */
+    while(left > 0)
     {
-		/* Read bytes from stego image, then pass it to decoding function and write the decoded characters character by character into decode.txt */
-        fread(decInfo -> decode_data, 8, sizeof (char), decInfo -> fptr_stego_image);
-        decode_byte_from_lsb(&ch, decInfo -> decode_data);
-        fprintf(decInfo->fptr_decode_text,"%c",ch);
+        uint count = left < (long) sizeof (out) ? (uint) left : (uint) sizeof (out);
+
+        if(cover_read_channels(&decInfo -> cover, decInfo -> fptr_stego_image, buf, count * 8) != count * 8)
+        {
+            return e_failure;
+        }
+        decode_bytes_from_lsb(out, buf, count);
+        fwrite(out, 1, count, decInfo -> fptr_decode_text);
+        left -= count;
+    }
+	/* No failure return e_success */
+    return e_success;
+}
+
+/* Decode count bytes, at most COVER_COPY_BUF_SIZE / 8, from the next channel bytes */
+static Status decode_payload_bytes(DecodeInfo *decInfo, char *out, uint count)
+{
+    char buf[COVER_COPY_BUF_SIZE];
+
+    if(cover_read_channels(&decInfo -> cover, decInfo -> fptr_stego_image, buf, count * 8) != count * 8)
+    {
+        return e_failure;
+    }
+    decode_bytes_from_lsb(out, buf, count);
+
+    return e_success;
+}
+
+/* Read and check the archive index */
+static Status decode_archive_index(DecodeInfo *decInfo)
+{
+    Archive *archive = &decInfo -> archive_index;
+    unsigned char buf[ARCHIVE_MAX_NAME + ARCHIVE_ENTRY_FIXED_BYTES];
+
+    if(decInfo -> decode_file_size < ARCHIVE_COUNT_BYTES ||
+       decode_payload_bytes(decInfo, (char *) buf, ARCHIVE_COUNT_BYTES) == e_failure ||
+       archive_begin_index(archive, buf, decInfo -> decode_file_size) == e_failure)
+    {
+        return e_failure;
+    }
+
+	/* Each entry is its name length, then the name and the fixed fields */
+    while(archive -> count < archive -> allocated)
+    {
+        unsigned char name_len;
+        uint size;
+
+        if(archive -> index_size + ARCHIVE_ENTRY_FIXED_BYTES > decInfo -> decode_file_size ||
+           decode_payload_bytes(decInfo, (char *) &name_len, 1) == e_failure)
+        {
+            return e_failure;
+        }
+
+        size = archive_entry_size(name_len);
+        if(archive -> index_size + 1 + size > decInfo -> decode_file_size ||
+           decode_payload_bytes(decInfo, (char *) buf, size) == e_failure ||
+           archive_add_entry(archive, name_len, buf) == e_failure)
+        {
+            return e_failure;
+        }
+    }
+
+    return archive_finish_index(archive, decInfo -> decode_file_size);
+}
+
+/*
+ * Decode the archive
+ * Input: Stego image positioned after the header
+ * Output: The index printed, or one member written to the decode file
+ * Description: Only the index is read before the member, whose
+ * channel bytes are seeked to from its offset. The member data is
+ * checked against the CRC-32 of the index.
+ */
+Status decode_archive_data(DecodeInfo *decInfo)
+{
+    Archive *archive = &decInfo -> archive_index;
+    const ArchiveEntry *entry;
+    char out[COVER_COPY_BUF_SIZE / 8];
+    uLong crc = crc32(0, Z_NULL, 0);
+    long left;
+
+    if(!decInfo -> archive)
+    {
+        fprintf(stderr, "ERROR: %s does not hold an archive\n", decInfo -> stego_image_fname);
+        return e_failure;
+    }
+    if(decode_archive_index(decInfo) == e_failure)
+    {
+        fprintf(stderr, "ERROR: Archive index of %s is damaged\n", decInfo -> stego_image_fname);
+        return e_failure;
+    }
+
+    if(decInfo -> list_archive)
+    {
+        printf("archive=%s entries=%u index_bytes=%u data_bytes=%llu\n", decInfo -> stego_image_fname,
+               archive -> count, archive -> index_size, archive -> data_size);
+        for(uint i = 0; i < archive -> count; i++)
+        {
+            entry = &archive -> entries[i];
+            printf("entry=%s offset=%u length=%u crc32=%08x\n", entry -> name, entry -> offset, entry -> length, entry -> crc);
+        }
+        return e_success;
+    }
+
+    if(decInfo -> extract_name == NULL)
+    {
+        fprintf(stderr, "ERROR: %s holds an archive of %u files, use --list or --extract=name\n",
+                decInfo -> stego_image_fname, archive -> count);
+        return e_failure;
+    }
+
+    entry = archive_find(archive, decInfo -> extract_name);
+    if(entry == NULL)
+    {
+        fprintf(stderr, "ERROR: %s is not in the archive\n", decInfo -> extract_name);
+        return e_failure;
+    }
+
+    if(decInfo -> fptr_decode_text == NULL)
+    {
+        decInfo -> fptr_decode_text = fopen(decInfo -> decode_fname, "w");
+        if(decInfo -> fptr_decode_text == NULL)
+        {
+            perror("fopen");
+            fprintf(stderr, "ERROR: Unable to open file %s\n", decInfo -> decode_fname);
+            return e_failure;
+        }
+    }
+
+	/* Straight to the channel bytes of the member */
+    if(cover_skip_channels(&decInfo -> cover, decInfo -> fptr_stego_image, (unsigned long long) entry -> offset * 8) == e_failure)
+    {
+        return e_failure;
+    }
+
+    for(left = entry -> length; left > 0; )
+    {
+        uint count = left < (long) sizeof (out) ? (uint) left : (uint) sizeof (out);
+
+        if(decode_payload_bytes(decInfo, out, count) == e_failure)
+        {
+            return e_failure;
+        }
+        crc = crc32(crc, (const Bytef *) out, count);
+        fwrite(out, 1, count, decInfo -> fptr_decode_text);
+        left -= count;
+    }
+
+    if(crc != entry -> crc)
+    {
+        fprintf(stderr, "ERROR: CRC-32 of %s does not match the index\n", entry -> name);
+        return e_failure;
+    }
+    printf("Extracted %s, %u bytes\n", entry -> name, entry -> length);
+
+    return e_success;
+}
+
+/*
+ * Gather the secret data from the textured blocks
+ * Input: Stego image positioned after the header
+ * Output: Secret data in decode.txt
+ * Description: The texture map is built again from the stego
+ * image, embedding left it unchanged. The span is then read
+ * again past the header and each payload slot gives the bit
+ * the keyed permutation assigns to it. The permutation spreads the
+ * bits over the whole span, so they are gathered in one pass into
+ * a buffer for the secret data, whose size was checked against the
+ * slots of the cover first; the encoder holds the same buffer.
+ */
+Status decode_adaptive_data(DecodeInfo *decInfo)
+{
+    char buf[COVER_COPY_BUF_SIZE];
+    unsigned char *secret;
+    unsigned long long bits = (unsigned long long) decInfo->decode_file_size * 8;
+    TextureMap texture;
+    KeyedPermutation perm;
+    TextureCursor cursor = { 0, 0 };
+    uint header_span = get_header_span(1);
+    uint slot = 0;
+    uint n;
+
+	/* Map the texture in a pass of its own, then come back to the end of the header */
+    cover_release(&decInfo->cover);
+    if(texture_map_scan(&texture, decInfo->cover.format, decInfo->fptr_stego_image, header_span) == e_failure)
+    {
+        return e_failure;
+    }
+
+	/* The secret data must fit the slots before its buffer is sized from it */
+    if(bits > texture_slots(&texture, decInfo->texture_threshold) ||
+       cover_parse_header(decInfo->cover.format, decInfo->fptr_stego_image, &decInfo->cover) == e_failure ||
+       decInfo->cover.format->begin_span(decInfo->fptr_stego_image, NULL, &decInfo->cover) == e_failure ||
+       (decInfo->io_backend == e_io_uring && cover_attach_io(&decInfo->cover, decInfo->fptr_stego_image, NULL) == e_failure))
+    {
+        texture_map_free(&texture);
+        return e_failure;
+    }
+
+    while(decInfo->cover.span_pos < header_span)
+    {
+        n = header_span - decInfo->cover.span_pos;
+        if(cover_read_channels(&decInfo->cover, decInfo->fptr_stego_image, buf, n < COVER_COPY_BUF_SIZE ? n : COVER_COPY_BUF_SIZE) == 0)
+        {
+            texture_map_free(&texture);
+            return e_failure;
+        }
+    }
+
+    secret = calloc(decInfo->decode_file_size + 1, 1);
+    if(secret == NULL)
+    {
+        texture_map_free(&texture);
+        return e_failure;
+    }
+
+    keyed_permutation_init(&perm, texture_slots(&texture, decInfo->texture_threshold), texture_key(decInfo->key_phrase));
+    texture_cursor_advance(&texture, &cursor, header_span);
+
+    while(decInfo->cover.span_pos < decInfo->cover.pixel_span)
+    {
+        n = decInfo->cover.pixel_span - decInfo->cover.span_pos;
+        n = cover_read_channels(&decInfo->cover, decInfo->fptr_stego_image, buf, n < COVER_COPY_BUF_SIZE ? n : COVER_COPY_BUF_SIZE);
+        if(n == 0)
+        {
+            break;
+        }
+
+        for(uint i = 0; i < n; )
+        {
+            int eligible;
+            uint len = texture_run(&texture, &cursor, n - i, decInfo->texture_threshold, &eligible);
+
+            for(uint k = i; eligible && k < i + len; k++)
+            {
+                uint bit = keyed_permute(&perm, slot++);
+
+                if(bit < bits)
+                {
+                    secret[bit >> 3] |= (buf[k] & 1) << (7 - (bit & 7));
+                }
+            }
+            i += len;
+        }
+    }
+    texture_map_free(&texture);
+
+	/* A short span leaves bits out, a short write loses them */
+    if(slot != perm.size ||
+       fwrite(secret, 1, decInfo->decode_file_size, decInfo->fptr_decode_text) != (size_t) decInfo->decode_file_size)
+    {
+        free(secret);
+        return e_failure;
+    }
+    free(secret);
+
+    return e_success;
+}
+
+/* Function definition to decode the secret data k bits per group of channel bytes */
+Status decode_hamming_data(DecodeInfo *decInfo)
+{
+    char group[HAMMING_GROUP_SIZE(HAMMING_MAX_K)];
+    uint n = HAMMING_GROUP_SIZE(decInfo->hamming_k);
+    unsigned long long groups;
+    uint acc = 0;                   // Secret data bits not written yet
+    uint acc_bits = 0;
+    long written = 0;
+
+	/* The groups of the secret data must be inside the span */
+    groups = ((unsigned long long) decInfo->decode_file_size * 8 + decInfo->hamming_k - 1) / decInfo->hamming_k;
+    if(groups * n > decInfo->cover.pixel_span - decInfo->cover.span_pos)
+    {
+        return e_failure;
+    }
+
+    for(unsigned long long g = 0; g < groups; g++)
+    {
+        if(cover_read_channels(&decInfo->cover, decInfo->fptr_stego_image, group, n) != n)
+        {
+            return e_failure;
+        }
+        acc = (acc << decInfo->hamming_k) | hamming_syndrome(group, n);
+        acc_bits += decInfo->hamming_k;
+
+        /* Whole bytes go out MSB first, the zero padding of the last group is dropped */
+        while(acc_bits >= 8 && written < decInfo->decode_file_size)
+        {
+            fputc((acc >> (acc_bits - 8)) & 0xFF, decInfo->fptr_decode_text);
+            acc_bits -= 8;
+            written++;
+        }
     }
+
 	/* No failure return e_success */
     return e_success;
 }
@@ -231,13 +681,16 @@ Status do_decoding(DecodeInfo *decInfo)
                 if(decode_secret_file_extn(decInfo->extn_decode_file,decInfo) == e_success)
                 {
                     printf("File extension is matching as %s\n",".txt");
-                    if(decode_secret_file_size(decInfo) == e_success)
+                    if(decode_secret_file_size(decInfo) == e_success && validate_secret_file_size(decInfo) == e_success)
                     {
                         printf("Size of secret data to be decoded is %ld bytes\n",decInfo->decode_file_size);
                         
-						if(decode_secret_file_data(decInfo) == e_success)
+						if((decInfo->archive || decInfo->list_archive || decInfo->extract_name ? decode_archive_data(decInfo) :
+                            decInfo->adaptive ? decode_adaptive_data(decInfo) :
+                            decInfo->hamming_k ? decode_hamming_data(decInfo) : decode_secret_file_data(decInfo)) == e_success)
                         {
-                            printf("Text copied successfully to %s\n","decode.txt");
+                            if(!decInfo->list_archive)
+                                printf("Text copied successfully to %s\n", decInfo->decode_fname);
                         }
 						else
 						{
@@ -247,7 +700,7 @@ Status do_decoding(DecodeInfo *decInfo)
                     }
 					else
 					{
-						printf("File size could not be retrieved!!!\n");
+						printf("File size could not be retrieved or does not fit the image!!!\n");
 						return e_failure;
 					}
                 }
@@ -275,6 +728,9 @@ Status do_decoding(DecodeInfo *decInfo)
 		return e_failure;
 	}
 	
+    /* Release the streaming state of the cover format */
+    cover_release(&decInfo->cover);
+
 	/* No failure return e_success */
     return e_success;
 }
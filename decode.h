@@ -5,6 +5,9 @@
 #define DECODE_H
 
 #include "types.h" // Contains user defined types
+#include "cover.h" // Contains cover image formats
+#include "texture.h" // Contains the texture map of adaptive embedding
+#include "archive.h" // Contains the multi file archive
 
 #define MAX_SECRET_BUF_SIZE 1
 #define MAX_IMAGE_BUF_SIZE (MAX_SECRET_BUF_SIZE * 8)
@@ -24,6 +27,24 @@ typedef struct _DecodeInfo
     /* Stego Image Info */
     char *stego_image_fname;
     FILE *fptr_stego_image;
+    CoverInfo cover;
+
+    /* I/O backend streaming the stego image */
+    IoBackend io_backend;
+
+    /* Adaptive embedding, found from the magic string */
+    int adaptive;
+    const char *key_phrase;     // Orders the payload bits, NULL for the default key
+    uint texture_threshold;
+
+    /* Matrix embedding with a Hamming code, found from the parameter block */
+    uint hamming_k;
+
+    /* Archive of several files, found from the parameter block */
+    int archive;
+    int list_archive;           // Print the index instead of extracting
+    const char *extract_name;   // Member to extract, NULL for a plain secret file
+    Archive archive_index;
 
 } DecodeInfo;
 
@@ -36,9 +57,27 @@ Status do_decoding(DecodeInfo *decInfo);
 /* Get File pointers for i/p and o/p files */
 Status open_decode_files(DecodeInfo *decInfo);
 
+/* Close the files and release the cover */
+void close_decode_files(DecodeInfo *decInfo);
+
 /* Decode and check Magic String */
 Status decode_magic_string(const char *magic_string, DecodeInfo *decInfo);
 
+/* Decode count bytes from the LSBs of 8 * count bytes */
+void decode_bytes_from_lsb(char *out, const char *data_buffer, uint count);
+
+/* Check the decoded secret file size fits in the rest of the span */
+Status validate_secret_file_size(DecodeInfo *decInfo);
+
+/* Decode the parameter block */
+Status decode_stego_params(DecodeInfo *decInfo);
+
+/* Gather the secret data from the textured blocks */
+Status decode_adaptive_data(DecodeInfo *decInfo);
+
+/* Decode the secret data k bits per group of channel bytes */
+Status decode_hamming_data(DecodeInfo *decInfo);
+
 /* Decode a byte from LSB of stego image data array */
 Status decode_byte_from_lsb(char *ch, char *data_buffer);
 
@@ -54,6 +93,9 @@ Status decode_secret_file_extn(const char *decode_file_extn, DecodeInfo *decInfo
 /* Decode secret file data*/
 Status decode_data_from_image(const char *data, int size, FILE *fptr_stego_image, DecodeInfo *decInfo);
 
+/* Read the archive index, then list it or extract one member */
+Status decode_archive_data(DecodeInfo *decInfo);
+
 /* Copy decoded data to a new file decode.txt */
 Status decode_secret_file_data(DecodeInfo *decInfo);
 
@@ -1,24 +1,29 @@
 /* This file contains codes related to encoding */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "encode.h"
 #include "types.h"
 #include "common.h"
+#include "cover.h"
+#include "texture.h"
+#include "hamming.h"
+#include "kernels.h"
+#include "archive.h"
+#include <zlib.h>
 /* Function Definitions */
 
-/* Get image size
- * Input: Image file ptr
- * Output: width * height * bytes per pixel (3 in our case)
- * Description: In BMP Image, width is stored in offset 18,
- * and height after that. size is 4 bytes
- */
-
 /* Validating the files given through CLA */
 Status read_and_validate_encode_args(char *argv[], EncodeInfo *encInfo)
 {
-    /* Checking for .bmp source image passed */
-    if(strcmp((strstr(argv[2],".")), ".bmp") == 0)
+    /* Checking for a supported source image format passed */
+    if(argv[2] == NULL || argv[3] == NULL)
+    {
+        return e_failure;
+    }
+    encInfo -> cover.format = cover_format_for_fname(argv[2]);
+    if(encInfo -> cover.format != NULL)
     {
         encInfo -> src_image_fname = argv[2];
     }
@@ -28,7 +33,7 @@ Status read_and_validate_encode_args(char *argv[], EncodeInfo *encInfo)
     }
     
     /* Checking if .txt secret file passed */
-	if(strcmp((strstr(argv[3],".")), ".txt") == 0)
+	if(strrchr(argv[3], '.') != NULL && strcmp(strrchr(argv[3], '.'), ".txt") == 0)
     {
         encInfo -> secret_fname = argv[3];
     }
@@ -37,52 +42,54 @@ Status read_and_validate_encode_args(char *argv[], EncodeInfo *encInfo)
         return e_failure;
     }
 
-    /* Checking if stego.bmp given, if not assign by default */
+    /* Checking if stego image given, if not assign by default in the source image format */
     if(argv[4] != NULL)
     {
         encInfo -> stego_image_fname = argv[4];
     }
     else
     {
-        encInfo -> stego_image_fname = "stego.bmp";
+        encInfo -> stego_image_fname = (char *) encInfo -> cover.format -> default_stego_fname;
     }
     return e_success;
 }
 
-/* Function definition to get the image size details */
-uint get_image_size_for_bmp(FILE *fptr_image)
+/* Validating the cover, stego image and archive members given through CLA */
+Status read_and_validate_archive_args(char *argv[], EncodeInfo *encInfo)
 {
-    /* Variables for width and height */
-    uint width, height;
-
-    /* Place pointer to 18th byte to get the size details */ 
-    fseek(fptr_image, 18, SEEK_SET);
-
-    /* Read the width */
-    fread(&width, sizeof(int), 1, fptr_image);
-    printf("Source image width = %u\n", width);
+    /* Cover, stego image, then at least one member */
+    if(argv[2] == NULL || argv[3] == NULL || argv[4] == NULL)
+    {
+        return e_failure;
+    }
 
-    /* Read the height */ 
-	fread(&height, sizeof(int), 1, fptr_image);
-    printf("Source image height = %u\n", height);
+    encInfo -> cover.format = cover_format_for_fname(argv[2]);
+    if(encInfo -> cover.format == NULL || cover_format_for_fname(argv[3]) != encInfo -> cover.format)
+    {
+        return e_failure;
+    }
+    encInfo -> src_image_fname = argv[2];
+    encInfo -> stego_image_fname = argv[3];
+    encInfo -> archive_fnames = &argv[4];
 
-    /* Return image capacity */
-	return width * height * 3;
+    return e_success;
 }
 
 /* 
  * Get File pointers for i/p and o/p files
- * Inputs: Src Image file, Secret file and
- * Stego Image file
+ * Inputs: Src Image file and Secret file
  * Output: FILE pointer for above files
  * Return Value: e_success or e_failure, on file errors
  */
 
-/* Function definition to open files in relevant modes */
+/* Function definition to open files in relevant modes, files handed in by the caller are kept */
 Status open_files(EncodeInfo *encInfo)
 {
     /* Source image file */ 
-    encInfo->fptr_src_image = fopen(encInfo->src_image_fname, "r");
+    if(encInfo->fptr_src_image == NULL)
+    {
+        encInfo->fptr_src_image = fopen(encInfo->src_image_fname, "r");
+    }
 
 	/* Do Error handling */ 
     if (encInfo->fptr_src_image == NULL)
@@ -93,8 +100,17 @@ Status open_files(EncodeInfo *encInfo)
     	return e_failure;
     }
 
+    /* Archive members are opened one at a time while encoding */
+    if(encInfo->archive_fnames != NULL)
+    {
+        return e_success;
+    }
+
     /* Secret file */ 
-    encInfo->fptr_secret = fopen(encInfo->secret_fname, "r");
+    if(encInfo->fptr_secret == NULL)
+    {
+        encInfo->fptr_secret = fopen(encInfo->secret_fname, "r");
+    }
 
     /* Do Error handling */ 
     if (encInfo->fptr_secret == NULL)
@@ -104,9 +120,19 @@ Status open_files(EncodeInfo *encInfo)
 
     	return e_failure;
     }
-    
+
+    // No failure return e_success
+    return e_success;
+}
+
+/* Function definition to create the stego image, only done once the secret is known to fit */
+Status open_stego_file(EncodeInfo *encInfo)
+{
 	/* Stego Image file */ 
-    encInfo->fptr_stego_image = fopen(encInfo->stego_image_fname, "w");
+    if(encInfo->fptr_stego_image == NULL)
+    {
+        encInfo->fptr_stego_image = fopen(encInfo->stego_image_fname, "w");
+    }
     
     /* Do Error handling */ 
     if (encInfo->fptr_stego_image == NULL)
@@ -121,6 +147,30 @@ Status open_files(EncodeInfo *encInfo)
     return e_success;
 }
 
+/* Function definition to close the files and release the cover */
+void close_files(EncodeInfo *encInfo)
+{
+    cover_release(&encInfo->cover);
+    texture_map_free(&encInfo->texture);
+    archive_free(&encInfo->archive);
+
+    if(encInfo->fptr_src_image != NULL)
+    {
+        fclose(encInfo->fptr_src_image);
+        encInfo->fptr_src_image = NULL;
+    }
+    if(encInfo->fptr_secret != NULL)
+    {
+        fclose(encInfo->fptr_secret);
+        encInfo->fptr_secret = NULL;
+    }
+    if(encInfo->fptr_stego_image != NULL)
+    {
+        fclose(encInfo->fptr_stego_image);
+        encInfo->fptr_stego_image = NULL;
+    }
+}
+
 /* Function definition to get the secret file size */
 uint get_file_size(FILE *fptr_secret)
 {
@@ -131,31 +181,234 @@ uint get_file_size(FILE *fptr_secret)
     return ftell(fptr_secret);
 }
 
+/* Function definition to get the bytes embedded besides the secret data */
+uint get_encode_overhead(void)
+{
+	/* 2 byte magic string, 4 byte for .txt extension's size, 4 bytes of .txt, 4 bytes of secret file size */
+    return strlen(MAGIC_STRING) + sizeof (int) + strlen(".txt") + sizeof (int);
+}
+
+/* Function definition to get the secret data bytes a pixel span can hold */
+uint get_payload_capacity(uint pixel_span)
+{
+	/* Each embedded byte takes the LSB of 8 channel bytes */
+    uint capacity = pixel_span / 8;
+
+    return capacity > get_encode_overhead() ? capacity - get_encode_overhead() : 0;
+}
+
 /* Function definition to check if the secret file size is less than the source image size */
 Status check_capacity(EncodeInfo *encInfo)
 {
-	/* File pointers for source image and secret file */
-    encInfo->image_capacity = get_image_size_for_bmp(encInfo->fptr_src_image);
-    encInfo->size_secret_file = get_file_size(encInfo->fptr_secret);
+	/* Parse the source image header with its format, unless it was parsed before */
+    if(encInfo->cover_header != NULL && encInfo->cover_header->format == encInfo->cover.format)
+    {
+        encInfo->cover = *encInfo->cover_header;
+    }
+    else if(cover_parse_header(encInfo->cover.format, encInfo->fptr_src_image, &encInfo->cover) == e_failure)
+    {
+        fprintf(stderr, "ERROR: %s is not a supported %s image\n", encInfo->src_image_fname, encInfo->cover.format->name);
+        return e_failure;
+    }
+    printf("Source image width = %u\n", encInfo->cover.width);
+    printf("Source image height = %u\n", encInfo->cover.height);
+
+    /* Only one layout at a time */
+    if(check_layout_options(encInfo->adaptive, encInfo->hamming_k, encInfo->archive_fnames != NULL) == e_failure)
+    {
+        return e_failure;
+    }
+
+    /* An archive is its index followed by the members */
+    if(encInfo->archive_fnames != NULL)
+    {
+        if(archive_build(&encInfo->archive, encInfo->archive_fnames) == e_failure)
+        {
+            return e_failure;
+        }
+        encInfo->size_secret_file = encInfo->archive.index_size + encInfo->archive.data_size;
+        printf("Archive of %u files, %u index bytes and %llu data bytes\n", encInfo->archive.count,
+               encInfo->archive.index_size, encInfo->archive.data_size);
+    }
+    else
+    {
+        encInfo->size_secret_file = get_file_size(encInfo->fptr_secret);
+    }
+
+    /* Adaptive embedding only counts the textured blocks */
+    if(encInfo->adaptive)
+    {
+        return check_adaptive_capacity(encInfo);
+    }
+
+    /* The header is embedded even for an empty secret file */
+    if(get_layout_capacity(encInfo->cover.pixel_span, encInfo->hamming_k, encInfo->archive_fnames != NULL,
+                           &encInfo->image_capacity) == e_failure)
+    {
+        fprintf(stderr, "ERROR: %s is too small to hold the stego header\n", encInfo->src_image_fname);
+        return e_failure;
+    }
     
-	/* 54 byte header file,  2 byte magic string, 4 byte for .txt extension's size, 4 bytes of .txt, 4 bytes of secret file size, number of bytes that are to be encoded */
-	if(encInfo->image_capacity > (54 + ((2 + 4 + 4 + 4 + encInfo->size_secret_file) * 8)))
+	/* Channel bytes are compared in whole payload bytes, the header of the image is not part of the span */
+	if(encInfo->size_secret_file <= encInfo->image_capacity)
     {
         return e_success;
     }
     else
     {
+        fprintf(stderr, "ERROR: %ld bytes of secret data do not fit, image holds %u bytes\n", encInfo->size_secret_file, encInfo->image_capacity);
         return e_failure; 
     }
 }
 
+/* Function definition to check the embedding options pick one layout */
+Status check_layout_options(int adaptive, uint hamming_k, int archive)
+{
+    /* Bits go either to textured blocks in keyed order or to groups in span order */
+    if(adaptive && hamming_k != 0)
+    {
+        fprintf(stderr, "ERROR: Adaptive embedding and matrix embedding cannot be combined\n");
+        return e_failure;
+    }
+
+    /* Members are reached by their cover position, which only the plain layout gives */
+    if(archive && (adaptive || hamming_k != 0))
+    {
+        fprintf(stderr, "ERROR: Archives use the plain layout, without adaptive or matrix embedding\n");
+        return e_failure;
+    }
+
+    return e_success;
+}
+
+/*
+ * Get the secret data bytes of a sequential layout
+ * Input: Pixel span, Hamming k or 0, and whether an archive is embedded
+ * Output: Capacity in secret data bytes, an archive counts its index
+ * Return Value: e_failure when the span can not hold the header
+ * Description: Shared by the encoder and the planner, so -p never
+ * reports a fit the encoder refuses.
+ */
+Status get_layout_capacity(uint pixel_span, uint hamming_k, int archive, uint *capacity)
+{
+    *capacity = 0;
+    if(pixel_span < get_header_span(hamming_k != 0 || archive))
+    {
+        return e_failure;
+    }
+
+    /* Matrix embedding fits k bits in every group of 2^k - 1 channel bytes */
+    if(hamming_k != 0)
+    {
+        *capacity = get_hamming_capacity(pixel_span, hamming_k);
+    }
+    else
+    {
+        *capacity = get_payload_capacity(pixel_span);
+
+        /* The parameter block of an archive comes out of the secret data bytes */
+        if(archive)
+        {
+            *capacity = *capacity > PARAM_BYTES ? *capacity - PARAM_BYTES : 0;
+        }
+    }
+
+    return e_success;
+}
+
+/* Function definition to get the span bytes holding everything before the secret data */
+uint get_header_span(int with_params)
+{
+	/* Secret data bytes aside, every embedded byte takes 8 channel bytes */
+    return (get_encode_overhead() + (with_params ? PARAM_BYTES : 0)) * 8;
+}
+
+/* Function definition to get the secret data bytes a pixel span can hold with matrix embedding */
+uint get_hamming_capacity(uint pixel_span, uint k)
+{
+    unsigned long long groups;
+
+    if(pixel_span < get_header_span(1))
+    {
+        return 0;
+    }
+
+	/* The header is embedded one bit per channel byte, the rest in whole groups */
+    groups = (pixel_span - get_header_span(1)) / HAMMING_GROUP_SIZE(k);
+
+    return groups * k / 8;
+}
+
+/*
+ * Map the cover texture and pick the blocks holding the secret data
+ * Input: Parsed source image and secret file size
+ * Output: Texture map and the lowest texture level used
+ * Description: The header is embedded at the start of the span as
+ * usual. The secret data only goes into the most textured blocks,
+ * as many levels down as it needs.
+ */
+Status check_adaptive_capacity(EncodeInfo *encInfo)
+{
+    unsigned long long capacity;
+
+    if(encInfo->cover.pixel_span < get_header_span(1) ||
+       texture_map_scan(&encInfo->texture, encInfo->cover.format, encInfo->fptr_src_image, get_header_span(1)) == e_failure)
+    {
+        fprintf(stderr, "ERROR: Unable to map the texture of %s\n", encInfo->src_image_fname);
+        return e_failure;
+    }
+
+	/* The scan leaves the source anywhere, parse it again for the embed pass */
+    if(encInfo->cover_header != NULL && encInfo->cover_header->format == encInfo->cover.format)
+    {
+        encInfo->cover = *encInfo->cover_header;
+    }
+    else if(cover_parse_header(encInfo->cover.format, encInfo->fptr_src_image, &encInfo->cover) == e_failure)
+    {
+        return e_failure;
+    }
+
+    capacity = texture_slots(&encInfo->texture, 1) / 8;
+    encInfo->image_capacity = capacity < (uint) -1 ? capacity : (uint) -1;
+    if(encInfo->size_secret_file > encInfo->image_capacity)
+    {
+        fprintf(stderr, "ERROR: %ld bytes of secret data do not fit, textured blocks hold %u bytes\n", encInfo->size_secret_file, encInfo->image_capacity);
+        return e_failure;
+    }
+
+    encInfo->texture_threshold = texture_threshold(&encInfo->texture, (unsigned long long) encInfo->size_secret_file * 8);
+    if(encInfo->texture_threshold == 0)
+    {
+        encInfo->texture_threshold = 1;
+    }
+    printf("Texture threshold = %u, %llu of %llu channel bytes open to the secret data\n", encInfo->texture_threshold,
+           texture_slots(&encInfo->texture, encInfo->texture_threshold), texture_slots(&encInfo->texture, 1));
+
+    return e_success;
+}
+
 /* Function definition to copy the source image header to stego image */
-Status copy_bmp_header(FILE *fptr_src, FILE *fptr_stego)
+Status copy_cover_header(EncodeInfo *encInfo)
 {
-    fseek(fptr_src, 0, SEEK_SET);                //Point to starting of source image
-    char str[54];                                //Array to store the header
-    fread(str, sizeof(char), 54, fptr_src);      //Read the 54 bytes from source image
-    fwrite(str, sizeof(char), 54,fptr_stego);    //Store the 54 bytes in stego.bmp
+    /* The format copies everything before the pixel span and leaves the source on its first channel byte */
+    if(encInfo->cover.format->begin_span(encInfo->fptr_src_image, encInfo->fptr_stego_image, &encInfo->cover) == e_failure)
+    {
+        return e_failure;
+    }
+
+    /* Metrics follow every span byte from here on */
+    if(encInfo->metrics != NULL)
+    {
+        metrics_init(encInfo->metrics, encInfo->cover.channels, encInfo->cover.width * encInfo->cover.channels, encInfo->cover.row_stride);
+        encInfo->cover.metrics = encInfo->metrics;
+    }
+
+    /* The rest of the image is streamed by the engine, keeping several chunks in flight */
+    if(encInfo->io_backend == e_io_uring)
+    {
+        return cover_attach_io(&encInfo->cover, encInfo->fptr_src_image, encInfo->fptr_stego_image);
+    }
+
     return e_success;
 }
 
@@ -185,7 +438,7 @@ Status encode_byte_to_lsb(char data, char *image_buffer)
 /* Function definition to encode size related data */
 Status encode_size_to_lsb(char *buffer, int size)
 {
-    unsigned int mask = 1 << 31;
+    unsigned int mask = 1u << 31;
     for(int i = 0; i < 32; i++)
     {
         //data & mask will give the MSB bit in the 1st iteration
@@ -202,15 +455,17 @@ Status encode_size_to_lsb(char *buffer, int size)
 }
 
 /* Function definition related to encode size related data */
-Status encode_size(int size, FILE *src, FILE *stego)
+Status encode_size(int size, EncodeInfo *encInfo)
 {
-    char str[32];						//data buffer
-    fread(str,32,sizeof (char), src);	//store data to buffer
-    encode_size_to_lsb(str,size);		//function call to encode size into the bytes in the buffer
-    fwrite(str,32,sizeof (char),stego);	//write the modified buffer into stego image
+    char str[32];															//data buffer
+    if(cover_read_channels(&encInfo->cover, encInfo->fptr_src_image, str, 32) != 32)	//store data to buffer
+    {
+        return e_failure;
+    }
+    encode_size_to_lsb(str,size);											//function call to encode size into the bytes in the buffer
     
-	// No failure return e_success
-    return e_success;
+	// A short write fails, no failure return e_success
+    return cover_write_channels(&encInfo->cover, encInfo->fptr_stego_image, str, 32) == 32 ? e_success : e_failure;
 }
 
 /* Function definition to encode data into the stego image */
@@ -220,9 +475,15 @@ Status encode_data_to_image(const char *data, int size, FILE *fptr_src_img, FILE
     //Each time pass 1 byte data along with 8 byte of beautiful.bmp
     for(int i = 0; i < size; i++)
     {
-        fread(encInfo->image_data, sizeof(char), 8, fptr_src_img);		//Read source image bytes into a buffer
-        encode_byte_to_lsb(data[i], encInfo->image_data);				//Modify the buffer bytes by encoding the data
-        fwrite(encInfo->image_data, sizeof(char), 8, fptr_stego_img);	//Write the buffer bytes to stego image
+        if(cover_read_channels(&encInfo->cover, fptr_src_img, encInfo->image_data, 8) != 8)		//Read source image bytes into a buffer
+        {
+            return e_failure;
+        }
+        encode_byte_to_lsb(data[i], encInfo->image_data);								//Modify the buffer bytes by encoding the data
+        if(cover_write_channels(&encInfo->cover, fptr_stego_img, encInfo->image_data, 8) != 8)	//Write the buffer bytes to stego image
+        {
+            return e_failure;
+        }
     }
 	
 	// No failure return e_success
@@ -233,10 +494,7 @@ Status encode_data_to_image(const char *data, int size, FILE *fptr_src_img, FILE
 Status encode_magic_string(const char *magic_string, EncodeInfo *encInfo)
 {
     //Every encoding needs to call a function encode_data_to_image
-    encode_data_to_image(magic_string, strlen(magic_string), encInfo->fptr_src_image, encInfo->fptr_stego_image, encInfo);
-	
-	// No failure return e_success
-    return e_success;
+    return encode_data_to_image(magic_string, strlen(magic_string), encInfo->fptr_src_image, encInfo->fptr_stego_image, encInfo);
 }
 
 /* Function definition to encode secret file extension */
@@ -245,58 +503,286 @@ Status encode_secret_file_extn(const char *file_ext, EncodeInfo *encInfo)
     file_ext = ".txt";
     
 	//Every encoding needs to call a function encode_data_to_image
-    encode_data_to_image(file_ext, strlen(file_ext), encInfo->fptr_src_image, encInfo->fptr_stego_image, encInfo);
-	
-	// No failure return e_success
-    return e_success;
+    return encode_data_to_image(file_ext, strlen(file_ext), encInfo->fptr_src_image, encInfo->fptr_stego_image, encInfo);
 }
 
 /* Function definition to encode secret file size */
 Status encode_secret_file_size(long int size, EncodeInfo *encInfo)
 {
-    char str[32];											//Buffer to hold the bytes
-    fread(str,32,sizeof (char), encInfo->fptr_src_image);	//Read the bytes from source image to buffer
-    encode_size_to_lsb(str,size);							//Encode the size to bytes of the buffer
-    fwrite(str,32,sizeof (char), encInfo->fptr_stego_image);//Write the buffer to stego image
+    char str[32];															//Buffer to hold the bytes
+    if(cover_read_channels(&encInfo->cover, encInfo->fptr_src_image, str, 32) != 32)	//Read the bytes from source image to buffer
+    {
+        return e_failure;
+    }
+    encode_size_to_lsb(str,size);											//Encode the size to bytes of the buffer
 
-	// No failure return e_success
-    return e_success;
+	// A short write fails, no failure return e_success
+    return cover_write_channels(&encInfo->cover, encInfo->fptr_stego_image, str, 32) == 32 ? e_success : e_failure;
 }
 
 /* Function definition to encode the secret file data */
+/* Embed count bytes, at most COVER_COPY_BUF_SIZE / 8, into the next channel bytes */
+static Status encode_payload_bytes(EncodeInfo *encInfo, const char *data, uint count)
+{
+    char buf[COVER_COPY_BUF_SIZE];
+
+    if(cover_read_channels(&encInfo -> cover, encInfo -> fptr_src_image, buf, count * 8) != count * 8)
+    {
+        return e_failure;
+    }
+    lsb_kernels() -> embed(buf, data, count);
+
+    return cover_write_channels(&encInfo -> cover, encInfo -> fptr_stego_image, buf, count * 8) == count * 8 ? e_success : e_failure;
+}
+
+/* Embed size bytes of a file from its current position, updating a CRC-32 of them when crc is not NULL */
+static Status encode_file_bytes(EncodeInfo *encInfo, FILE *fptr, long size, uLong *crc)
+{
+    char data[COVER_COPY_BUF_SIZE / 8];
+    long left = size;
+
+	/* Capacity was checked, so whole buffers go through the kernel until the file size is reached */
+    while(left > 0)
+    {
+        uint count = left < (long) sizeof (data) ? (uint) left : (uint) sizeof (data);
+
+        if(fread(data, 1, count, fptr) != count || encode_payload_bytes(encInfo, data, count) == e_failure)
+        {
+            return e_failure;
+        }
+        if(crc != NULL)
+        {
+            *crc = crc32(*crc, (const Bytef *) data, count);
+        }
+        left -= count;
+    }
+
+    return e_success;
+}
+
 Status encode_secret_file_data(EncodeInfo *encInfo)
 {
-    char ch;
+	/* Point to the starting position of secret file */
+    fseek(encInfo->fptr_secret, 0, SEEK_SET);
+
+    return encode_file_bytes(encInfo, encInfo -> fptr_secret, encInfo -> size_secret_file, NULL);
+}
+
+/*
+ * Encode the archive
+ * Input: Archive index built by check_capacity
+ * Output: Index and members embedded after the header
+ * Description: The index goes first so a decoder finds the cover
+ * position of any member without reading the others. Members are
+ * read again from their files, and a member that changed since the
+ * index was built fails the encoding.
+ */
+Status encode_archive_data(EncodeInfo *encInfo)
+{
+    Archive *archive = &encInfo -> archive;
+    unsigned char *index = malloc(archive -> index_size);
+    Status ret = e_success;
+
+    if(index == NULL)
+    {
+        return e_failure;
+    }
+    archive_write_index(archive, index);
+
+    for(uint done = 0; done < archive -> index_size && ret == e_success; done += COVER_COPY_BUF_SIZE / 8)
+    {
+        uint count = archive -> index_size - done < COVER_COPY_BUF_SIZE / 8 ? archive -> index_size - done : COVER_COPY_BUF_SIZE / 8;
+
+        ret = encode_payload_bytes(encInfo, (const char *) index + done, count);
+    }
+    free(index);
+
+    for(uint i = 0; i < archive -> count && ret == e_success; i++)
+    {
+        const ArchiveEntry *entry = &archive -> entries[i];
+        FILE *fptr = fopen(entry -> fname, "r");
+        uLong crc = crc32(0, Z_NULL, 0);
+
+        if(fptr == NULL)
+        {
+            perror("fopen");
+            fprintf(stderr, "ERROR: Unable to open file %s\n", entry -> fname);
+            return e_failure;
+        }
+
+        ret = encode_file_bytes(encInfo, fptr, entry -> length, &crc);
+        if(ret == e_success && (crc != entry -> crc || fgetc(fptr) != EOF))
+        {
+            fprintf(stderr, "ERROR: %s changed while it was being encoded\n", entry -> fname);
+            ret = e_failure;
+        }
+        fclose(fptr);
+    }
+
+    return ret;
+}
+
+/* Function definition to encode the parameter block */
+Status encode_stego_params(EncodeInfo *encInfo)
+{
+    char params[PARAM_BYTES] =
+    {
+        (char) ((encInfo->adaptive ? PARAM_ADAPTIVE : 0) | (encInfo->archive_fnames != NULL ? PARAM_ARCHIVE : 0) |
+                encInfo->hamming_k << PARAM_HAMMING_SHIFT),
+        (char) encInfo->texture_threshold
+    };
+
+    return encode_data_to_image(params, PARAM_BYTES, encInfo->fptr_src_image, encInfo->fptr_stego_image, encInfo);
+}
+
+/*
+ * Spread the secret data over the textured blocks
+ * Input: Source image positioned after the header
+ * Output: Rest of the span with the secret data bits embedded
+ * Description: Channel bytes of blocks at or above the threshold
+ * are payload slots, counted in span order. A keyed permutation
+ * gives the secret data bit each slot carries, so the bits are
+ * scattered over all the textured blocks and the decoder finds
+ * them again from the stego image and the key alone.
+ */
+Status encode_adaptive_data(EncodeInfo *encInfo)
+{
+    char buf[COVER_COPY_BUF_SIZE];
+    unsigned char *secret;
+    unsigned long long bits = (unsigned long long) encInfo->size_secret_file * 8;
+    KeyedPermutation perm;
+    TextureCursor cursor = { 0, 0 };
+    uint slot = 0;
+    uint n;
+
+    secret = malloc(encInfo->size_secret_file + 1);
+    if(secret == NULL)
+    {
+        return e_failure;
+    }
+
+	/* The secret data is read once, the slots ask for its bits in any order */
+    fseek(encInfo->fptr_secret, 0, SEEK_SET);
+    if(fread(secret, 1, encInfo->size_secret_file, encInfo->fptr_secret) != (size_t) encInfo->size_secret_file)
+    {
+        free(secret);
+        return e_failure;
+    }
+
+    keyed_permutation_init(&perm, texture_slots(&encInfo->texture, encInfo->texture_threshold), texture_key(encInfo->key_phrase));
+    texture_cursor_advance(&encInfo->texture, &cursor, encInfo->cover.span_pos);
+
+    while(encInfo->cover.span_pos < encInfo->cover.pixel_span)
+    {
+        n = encInfo->cover.pixel_span - encInfo->cover.span_pos;
+        n = cover_read_channels(&encInfo->cover, encInfo->fptr_src_image, buf, n < COVER_COPY_BUF_SIZE ? n : COVER_COPY_BUF_SIZE);
+        if(n == 0)
+        {
+            break;
+        }
+
+        for(uint i = 0; i < n; )
+        {
+            int eligible;
+            uint len = texture_run(&encInfo->texture, &cursor, n - i, encInfo->texture_threshold, &eligible);
+
+            for(uint k = i; eligible && k < i + len; k++)
+            {
+                uint bit = keyed_permute(&perm, slot++);
+
+                if(bit < bits)
+                {
+                    buf[k] = (buf[k] & 0xFE) | ((secret[bit >> 3] >> (7 - (bit & 7))) & 1);
+                }
+            }
+            i += len;
+        }
+
+        if(cover_write_channels(&encInfo->cover, encInfo->fptr_stego_image, buf, n) != n)
+        {
+            free(secret);
+            return e_failure;
+        }
+    }
+    free(secret);
+
+	/* Every slot has been visited, so every bit is in */
+    return slot == perm.size ? e_success : e_failure;
+}
+
+/*
+ * Encode the secret data k bits per group of channel bytes
+ * Input: Source image positioned after the header
+ * Output: Secret data embedded by matrix embedding
+ * Description: The secret data is cut into k bit messages, MSB
+ * first, the last one padded with zeros. Each message goes into
+ * the next 2^k - 1 channel bytes, changing at most one LSB.
+ */
+Status encode_hamming_data(EncodeInfo *encInfo)
+{
+    char group[HAMMING_GROUP_SIZE(HAMMING_MAX_K)];
+    uint n = HAMMING_GROUP_SIZE(encInfo->hamming_k);
+    unsigned long long left = (unsigned long long) encInfo->size_secret_file * 8;
+    uint acc = 0;                   // Secret data bits not embedded yet
+    uint acc_bits = 0;
+    int ch;
 
 	/* Point to the starting position of secret file */
     fseek(encInfo->fptr_secret, 0, SEEK_SET);
 
-	/* Call encode function upto the file size reached */
-    for(int i = 0; i < encInfo -> size_secret_file; i++)
+    while(left > 0)
     {
-        fread(encInfo -> image_data, 8, sizeof (char), encInfo -> fptr_src_image);		//Read bytes from source image to buffer
-        fread(&ch, 1, sizeof (char), encInfo -> fptr_secret);							//Read characters from secret file and store in ch
-        encode_byte_to_lsb(ch, encInfo -> image_data);									//Encode the characters into the bytes of the buffer
-        fwrite(encInfo -> image_data, 8, sizeof (char), encInfo -> fptr_stego_image);	//Write the buffer to stego image
+        uint msg;
+
+        /* Refill the bits from the secret file, zeros once it runs out */
+        while(acc_bits < encInfo->hamming_k)
+        {
+            ch = fgetc(encInfo->fptr_secret);
+            acc = (acc << 8) | (ch == EOF ? 0 : (unsigned char) ch);
+            acc_bits += 8;
+        }
+        msg = (acc >> (acc_bits - encInfo->hamming_k)) & n;
+        acc_bits -= encInfo->hamming_k;
+        left = left > encInfo->hamming_k ? left - encInfo->hamming_k : 0;
+
+        if(cover_read_channels(&encInfo->cover, encInfo->fptr_src_image, group, n) != n)
+        {
+            return e_failure;
+        }
+        hamming_embed(group, n, msg);
+        if(cover_write_channels(&encInfo->cover, encInfo->fptr_stego_image, group, n) != n)
+        {
+            return e_failure;
+        }
     }
-	
+
 	// No failure return e_success
     return e_success;
 }
 
 /* Function definition to copy remaining bytes of source image to stego image */
-Status copy_remaining_img_data(FILE *fptr_src, FILE *fptr_stego)
+Status copy_remaining_img_data(CoverInfo *cover, FILE *fptr_src, FILE *fptr_stego)
 {
-    char ch;
+    char buf[COVER_COPY_BUF_SIZE];
+    uint n;
 
-	/* Read and write from source image to stego image until end of file reached */
-    while(fread(&ch, 1, 1, fptr_src) > 0)
+	/* Read and write the channel bytes left in the span */
+    while(cover->span_pos < cover->pixel_span)
     {
-        fwrite(&ch, 1, 1, fptr_stego);        
+        n = cover->pixel_span - cover->span_pos;
+        n = cover_read_channels(cover, fptr_src, buf, n < COVER_COPY_BUF_SIZE ? n : COVER_COPY_BUF_SIZE);
+        if(n == 0)
+        {
+            break;
+        }
+        if(cover_write_channels(cover, fptr_stego, buf, n) != n)
+        {
+            return e_failure;
+        }
     }
-	
-	// No failure return e_success
-    return e_success;
+
+	/* Copy whatever the format stores after the span until end of file reached */
+    return cover->format->end_span(fptr_src, fptr_stego, cover);
 }
 
 /* Function definition for encoding */
@@ -306,19 +792,21 @@ Status do_encoding(EncodeInfo *encInfo)
     {
         printf("Opened all files successfully\n");
         printf("Starting Encoding...\n");
-        if(check_capacity(encInfo) == e_success)
+        if(check_capacity(encInfo) == e_success && open_stego_file(encInfo) == e_success)
         {
-            printf("Secret data can be encoded in .bmp\n");
+            printf("Secret data can be encoded in .%s\n", encInfo->cover.format->name);
 
-            if(copy_bmp_header(encInfo->fptr_src_image, encInfo->fptr_stego_image) == e_success)
+            if(copy_cover_header(encInfo) == e_success)
             {
                 printf("Header file of source image copied to stego image successfully\n");
                 
-				if(encode_magic_string(MAGIC_STRING, encInfo) == e_success)
+				if(encode_magic_string(encInfo->adaptive || encInfo->hamming_k || encInfo->archive_fnames ?
+                                       PARAM_MAGIC_STRING : MAGIC_STRING, encInfo) == e_success &&
+                   ((!encInfo->adaptive && !encInfo->hamming_k && !encInfo->archive_fnames) || encode_stego_params(encInfo) == e_success))
                 {
                     printf("Magic string encoded successfully to stego image\n");
                     
-					if(encode_size(strlen(".txt"), encInfo->fptr_src_image, encInfo->fptr_stego_image) == e_success)
+					if(encode_size(strlen(".txt"), encInfo) == e_success)
                     {
                         printf("Encoded secret file extension size successfully to stego image\n");
                         
@@ -330,11 +818,13 @@ Status do_encoding(EncodeInfo *encInfo)
                             {
                                 printf("Encoded secret file size succesfully to stego image\n");
                                 
-								if(encode_secret_file_data(encInfo) == e_success)
+								if((encInfo->adaptive ? encode_adaptive_data(encInfo) :
+                                    encInfo->hamming_k ? encode_hamming_data(encInfo) :
+                                    encInfo->archive_fnames ? encode_archive_data(encInfo) : encode_secret_file_data(encInfo)) == e_success)
                                 {
                                     printf("Encoded secret data successfully to stego image\n");
                                     
-									if(copy_remaining_img_data(encInfo -> fptr_src_image, encInfo -> fptr_stego_image) == e_success)
+									if(copy_remaining_img_data(&encInfo -> cover, encInfo -> fptr_src_image, encInfo -> fptr_stego_image) == e_success)
                                     {
                                         printf("Copied remaining data of source image to stego image\n");
                                     }
@@ -364,7 +854,10 @@ Status do_encoding(EncodeInfo *encInfo)
                         }
                     }
                     else
+                    {
                         printf("Secret file extension size not encoded successfully!!!\n");
+                        return e_failure;
+                    }
                 }
                 else
                 {
@@ -389,5 +882,9 @@ Status do_encoding(EncodeInfo *encInfo)
         printf("File open failed!!!\n");
         return e_failure;
     }
+
+    /* Release the streaming state of the cover format */
+    cover_release(&encInfo->cover);
+
     return e_success;
 }
@@ -5,6 +5,11 @@
 #define ENCODE_H
 
 #include "types.h" // Contains user defined types
+#include "cover.h" // Contains cover image formats
+#include "metrics.h" // Contains quality and steganalysis metrics
+#include "texture.h" // Contains the texture map of adaptive embedding
+#include "hamming.h" // Contains matrix embedding
+#include "archive.h" // Contains the multi file archive
 
 /* 
  * Structure to store information required for
@@ -22,7 +27,9 @@ typedef struct _EncodeInfo
     /* Source Image info */
     char *src_image_fname;
     FILE *fptr_src_image;
-    uint image_capacity;
+    CoverInfo cover;
+    const CoverInfo *cover_header;  // Header parsed earlier, such as by the cover cache, NULL to parse the source
+    uint image_capacity;        // Secret data bytes the image can hold
     uint bits_per_pixel;
     char image_data[MAX_IMAGE_BUF_SIZE];
 
@@ -37,6 +44,25 @@ typedef struct _EncodeInfo
     char *stego_image_fname;
     FILE *fptr_stego_image;
 
+    /* I/O backend streaming the images */
+    IoBackend io_backend;
+
+    /* Metrics gathered in the embed pass, NULL when not wanted */
+    StegoMetrics *metrics;
+
+    /* Adaptive embedding into textured blocks */
+    int adaptive;
+    const char *key_phrase;     // Orders the payload bits, NULL for the default key
+    TextureMap texture;
+    uint texture_threshold;
+
+    /* Matrix embedding with a Hamming code, 0 for one bit per channel byte */
+    uint hamming_k;
+
+    /* Archive of several files in place of the secret file, NULL terminated */
+    char **archive_fnames;
+    Archive archive;
+
 } EncodeInfo;
 
 
@@ -48,23 +74,35 @@ OperationType check_operation_type(char *argv[]);
 /* Read and validate Encode args from argv */
 Status read_and_validate_encode_args(char *argv[], EncodeInfo *encInfo);
 
+/* Read and validate archive Encode args from argv */
+Status read_and_validate_archive_args(char *argv[], EncodeInfo *encInfo);
+
 /* Perform the encoding */
 Status do_encoding(EncodeInfo *encInfo);
 
 /* Get File pointers for i/p and o/p files */
 Status open_files(EncodeInfo *encInfo);
 
+/* Close the files and release the cover */
+void close_files(EncodeInfo *encInfo);
+
+/* Create the stego image file */
+Status open_stego_file(EncodeInfo *encInfo);
+
 /* check capacity */
 Status check_capacity(EncodeInfo *encInfo);
 
-/* Get image size */
-uint get_image_size_for_bmp(FILE *fptr_image);
+/* Get bytes embedded besides the secret data */
+uint get_encode_overhead(void);
+
+/* Get secret data bytes a pixel span can hold */
+uint get_payload_capacity(uint pixel_span);
 
 /* Get file size */
 uint get_file_size(FILE *fptr);
 
-/* Copy bmp image header */
-Status copy_bmp_header(FILE *fptr_src_image, FILE *fptr_dest_image);
+/* Copy cover image header */
+Status copy_cover_header(EncodeInfo *encInfo);
 
 /* Store Magic String */
 Status encode_magic_string(const char *magic_string, EncodeInfo *encInfo);
@@ -78,8 +116,35 @@ Status encode_secret_file_size(long file_size, EncodeInfo *encInfo);
 /* Encode secret file data*/
 Status encode_secret_file_data(EncodeInfo *encInfo);
 
+/* Get span bytes holding everything before the secret data */
+uint get_header_span(int with_params);
+
+/* Get secret data bytes a pixel span can hold with matrix embedding */
+uint get_hamming_capacity(uint pixel_span, uint k);
+
+/* Check the embedding options pick one layout */
+Status check_layout_options(int adaptive, uint hamming_k, int archive);
+
+/* Get secret data bytes of the plain, Hamming or archive layout, shared with the planner */
+Status get_layout_capacity(uint pixel_span, uint hamming_k, int archive, uint *capacity);
+
+/* Map the cover texture and pick the blocks holding the secret data */
+Status check_adaptive_capacity(EncodeInfo *encInfo);
+
+/* Encode the parameter block */
+Status encode_stego_params(EncodeInfo *encInfo);
+
+/* Spread the secret data over the textured blocks */
+Status encode_adaptive_data(EncodeInfo *encInfo);
+
+/* Encode the secret data k bits per group of channel bytes */
+Status encode_hamming_data(EncodeInfo *encInfo);
+
+/* Encode the archive index and its members */
+Status encode_archive_data(EncodeInfo *encInfo);
+
 /* Encode secret file extension size */
-Status encode_size(int size, FILE *fptr_src_img, FILE *fptr_stego_img);
+Status encode_size(int size, EncodeInfo *encInfo);
 
 /* Encode size to LSB */
 Status encode_size_to_lsb(char *buffer, int size);
@@ -91,7 +156,7 @@ Status encode_data_to_image(const char *data, int size, FILE *fptr_src_image, FI
 Status encode_byte_to_lsb(char data, char *image_buffer);
 
 /* Copy remaining image bytes from src to stego image after encoding */
-Status copy_remaining_img_data(FILE *fptr_src, FILE *fptr_dest);
+Status copy_remaining_img_data(CoverInfo *cover, FILE *fptr_src, FILE *fptr_dest);
 
 #endif
 
@@ -0,0 +1,55 @@
+/* This file contains the fuzz target for the cover header parsers */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "../cover.h"
+#include "../metrics.h"
+#include "../types.h"
+
+static const CoverFormat *const fuzz_formats[] = { &bmp_format, &ppm_format, &tga_format, &png_format };
+
+/*
+ * The first byte picks the cover format, the rest is the image.
+ * A header that passes validation has its whole span streamed,
+ * as analysing and encoding do.
+ */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    char buf[METRICS_BUF_SIZE];
+    StegoMetrics metrics;
+    CoverInfo cover;
+    FILE *fptr;
+    uint n;
+
+    if(size < 2)
+    {
+        return 0;
+    }
+
+    fptr = fmemopen((void *) (data + 1), size - 1, "r");
+    if(fptr == NULL)
+    {
+        return 0;
+    }
+
+    if(cover_parse_header(fuzz_formats[data[0] % 4], fptr, &cover) == e_success &&
+       cover.format->begin_span(fptr, NULL, &cover) == e_success)
+    {
+        metrics_init(&metrics, cover.channels, cover.width * cover.channels, cover.row_stride);
+        while(cover.span_pos < cover.pixel_span)
+        {
+            n = cover.pixel_span - cover.span_pos;
+            n = cover_read_channels(&cover, fptr, buf, n < METRICS_BUF_SIZE ? n : METRICS_BUF_SIZE);
+            if(n == 0)
+            {
+                break;
+            }
+            metrics_update(&metrics, NULL, (const unsigned char *) buf, n);
+        }
+    }
+    cover_release(&cover);
+    fclose(fptr);
+
+    return 0;
+}
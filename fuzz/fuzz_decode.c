@@ -0,0 +1,51 @@
+/* This file contains the fuzz target for decoding untrusted stego images */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "../decode.h"
+#include "../cover.h"
+#include "../types.h"
+
+/* File names only pick the cover format, nothing is opened by name */
+static const char *const fuzz_fnames[] = { "fuzz.bmp", "fuzz.ppm", "fuzz.tga", "fuzz.png" };
+
+/* Keep the progress messages of the decoder out of the fuzzer output */
+int LLVMFuzzerInitialize(int *argc, char ***argv)
+{
+    (void) argc;
+    (void) argv;
+    freopen("/dev/null", "w", stdout);
+
+    return 0;
+}
+
+/*
+ * The first byte picks the cover format, the rest is the stego image.
+ * It goes through the whole decoder: header parsing and validation,
+ * the magic string, the parameter block and every data layout.
+ */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    DecodeInfo decInfo;
+
+    if(size < 2)
+    {
+        return 0;
+    }
+
+    memset(&decInfo, 0, sizeof (decInfo));
+    decInfo.stego_image_fname = (char *) fuzz_fnames[data[0] % 4];
+    decInfo.decode_fname = "/dev/null";
+    decInfo.cover.format = cover_format_for_fname(decInfo.stego_image_fname);
+
+    decInfo.fptr_stego_image = fmemopen((void *) (data + 1), size - 1, "r");
+    decInfo.fptr_decode_text = fopen("/dev/null", "w");
+    if(decInfo.fptr_stego_image != NULL && decInfo.fptr_decode_text != NULL)
+    {
+        do_decoding(&decInfo);
+    }
+    close_decode_files(&decInfo);
+
+    return 0;
+}
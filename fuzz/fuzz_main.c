@@ -0,0 +1,73 @@
+/* This file contains a driver running a fuzz target over files, for AFL and for replaying crashes without libFuzzer */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+/* Provided by targets that need it, libFuzzer calls it the same way */
+__attribute__((weak)) int LLVMFuzzerInitialize(int *argc, char ***argv);
+
+/* Run the target once per file given, or once over stdin as AFL does without @@ */
+int main(int argc, char *argv[])
+{
+    uint8_t *data;
+    size_t size;
+    FILE *fptr;
+
+    if(LLVMFuzzerInitialize != NULL)
+    {
+        LLVMFuzzerInitialize(&argc, &argv);
+    }
+
+    for(int i = 1; i < argc || i == 1; i++)
+    {
+        fptr = i < argc ? fopen(argv[i], "rb") : stdin;
+        if(fptr == NULL)
+        {
+            perror(argv[i]);
+            return 1;
+        }
+
+        fseek(fptr, 0, SEEK_END);
+        size = ftell(fptr) < 0 ? 0 : ftell(fptr);
+        fseek(fptr, 0, SEEK_SET);
+
+        /* stdin may not be seekable, read it in pieces */
+        data = malloc(size + 1);
+        if(size == 0 && fptr == stdin)
+        {
+            size_t cap = 4096;
+            size_t n;
+
+            data = realloc(data, cap);
+            while(data != NULL && (n = fread(data + size, 1, cap - size, fptr)) > 0)
+            {
+                size += n;
+                if(size == cap)
+                {
+                    cap *= 2;
+                    data = realloc(data, cap);
+                }
+            }
+        }
+        else if(data != NULL && fread(data, 1, size, fptr) != size)
+        {
+            size = 0;
+        }
+
+        if(data != NULL)
+        {
+            LLVMFuzzerTestOneInput(data, size);
+        }
+        free(data);
+
+        if(fptr != stdin)
+        {
+            fclose(fptr);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,96 @@
+/* This file contains codes related to matrix embedding with Hamming codes */
+
+#include "hamming.h"
+#include "types.h"
+
+/*
+ * Matrix embedding (Crandall)
+ * Channel byte i of a group (1 based) stands for column i of the
+ * parity check matrix of the Hamming code, which is i in binary.
+ * The syndrome, the XOR of the positions whose LSB is set, is the
+ * message. Flipping the LSB at position syndrome ^ msg makes the
+ * group carry msg, so k bits cost at most one change in n bytes.
+ */
+
+/* XOR of the bit indices set in a byte, spelled out at compile time */
+#define X0(v) v, v
+#define X1(v) X0(v), X0((v) ^ 1)
+#define X2(v) X1(v), X1((v) ^ 2)
+#define X3(v) X2(v), X2((v) ^ 3)
+#define X4(v) X3(v), X3((v) ^ 4)
+#define X5(v) X4(v), X4((v) ^ 5)
+#define X6(v) X5(v), X5((v) ^ 6)
+#define X7(v) X6(v), X6((v) ^ 7)
+
+static const unsigned char index_xor[256] = { X7(0) };
+
+/* Parity of the bits set in a byte */
+#define P0(v) v, (v) ^ 1
+#define P1(v) P0(v), P0((v) ^ 1)
+#define P2(v) P1(v), P1((v) ^ 1)
+#define P3(v) P2(v), P2((v) ^ 1)
+#define P4(v) P3(v), P3((v) ^ 1)
+#define P5(v) P4(v), P4((v) ^ 1)
+#define P6(v) P5(v), P5((v) ^ 1)
+
+static const unsigned char parity[256] = { P6(0), P6(1) };
+
+/* Function Definitions */
+
+/* Function definition to find the syndrome of a group */
+uint hamming_syndrome(const char *group, uint n)
+{
+    uint syndrome = 0;
+    uint base = 0;
+    uint lsbs;
+
+	/* Positions 1 to 7 share their byte of LSBs with the unused position 0 */
+    lsbs = 0;
+    for(uint r = 1; r < 8 && r <= n; r++)
+    {
+        lsbs |= (group[r - 1] & 1) << r;
+    }
+    syndrome = index_xor[lsbs];
+
+	/*
+	 * Each further 8 positions base + r pack their LSBs into one byte,
+	 * the XOR of the positions is then base times the parity, XORed
+	 * with the XOR of the r, both read from the tables.
+	 */
+    for(base = 8; base + 7 <= n; base += 8)
+    {
+        const char *p = group + base - 1;
+
+        lsbs = (p[0] & 1) | (p[1] & 1) << 1 | (p[2] & 1) << 2 | (p[3] & 1) << 3 |
+               (p[4] & 1) << 4 | (p[5] & 1) << 5 | (p[6] & 1) << 6 | (p[7] & 1) << 7;
+        syndrome ^= index_xor[lsbs] ^ (parity[lsbs] ? base : 0);
+    }
+
+	/* Last partial byte of LSBs */
+    if(base <= n && base >= 8)
+    {
+        lsbs = 0;
+        for(uint r = 0; base + r <= n; r++)
+        {
+            lsbs |= (group[base + r - 1] & 1) << r;
+        }
+        syndrome ^= index_xor[lsbs] ^ (parity[lsbs] ? base : 0);
+    }
+
+    return syndrome;
+}
+
+/* Function definition to embed msg into a group */
+uint hamming_embed(char *group, uint n, uint msg)
+{
+    uint flip = hamming_syndrome(group, n) ^ msg;
+
+    if(flip == 0)
+    {
+        return 0;
+    }
+
+    group[flip - 1] ^= 1;
+
+    return 1;
+}
@@ -0,0 +1,19 @@
+/* This file contains the function prototypes for matrix embedding with Hamming codes */
+
+#ifndef HAMMING_H
+#define HAMMING_H
+
+#include "types.h" // Contains user defined types
+
+/* Code parameter k, a group of n = 2^k - 1 channel bytes carries k payload bits */
+#define HAMMING_MIN_K 2
+#define HAMMING_MAX_K 8
+#define HAMMING_GROUP_SIZE(k) ((1u << (k)) - 1)
+
+/* Syndrome of the LSBs of a group, the k bits it carries */
+uint hamming_syndrome(const char *group, uint n);
+
+/* Make the group carry msg by flipping at most one LSB, returns the number of LSBs flipped */
+uint hamming_embed(char *group, uint n, uint msg);
+
+#endif
@@ -0,0 +1,601 @@
+/* This file contains codes related to the asynchronous I/O engine */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include "io_engine.h"
+#include "types.h"
+
+#define IO_URING_ENTRIES 8
+
+/* Operations carried in the io_uring user data */
+#define IO_OP_READ 0
+#define IO_OP_WRITE 1
+
+/* Function Definitions */
+
+/*
+ * Check the kernel runs the opcodes the engine submits
+ * IORING_OP_READ and IORING_OP_WRITE came with 5.6, as did the probe,
+ * so a kernel refusing the probe is one of 5.1 to 5.5 and gets the pool.
+ */
+static Status io_uring_probe_ops(IoUring *ring)
+{
+    size_t size = sizeof (struct io_uring_probe) + IORING_OP_LAST * sizeof (struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, size);
+    Status ret = e_failure;
+
+    if(probe == NULL)
+    {
+        return e_failure;
+    }
+
+    if(syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) == 0 &&
+       probe->last_op >= IORING_OP_READ && probe->last_op >= IORING_OP_WRITE &&
+       (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) &&
+       (probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED))
+    {
+        ret = e_success;
+    }
+    free(probe);
+
+    return ret;
+}
+
+/* Map the io_uring submission and completion rings */
+static Status io_uring_open(IoUring *ring)
+{
+    struct io_uring_params p;
+    int single_mmap;
+
+    memset(&p, 0, sizeof (p));
+    ring->fd = syscall(__NR_io_uring_setup, IO_URING_ENTRIES, &p);
+    if(ring->fd < 0)
+    {
+        return e_failure;
+    }
+
+    ring->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof (unsigned);
+    ring->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof (struct io_uring_cqe);
+    ring->sqes_size = p.sq_entries * sizeof (struct io_uring_sqe);
+
+    /* Newer kernels map both rings with one mmap */
+    single_mmap = p.features & IORING_FEAT_SINGLE_MMAP;
+    if(single_mmap && ring->cq_ring_size > ring->sq_ring_size)
+    {
+        ring->sq_ring_size = ring->cq_ring_size;
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if(ring->sq_ring == MAP_FAILED)
+    {
+        close(ring->fd);
+        return e_failure;
+    }
+
+    ring->cq_ring = single_mmap ? ring->sq_ring : mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+
+    /* Unmap whatever did map, the kernel may also lack the read and write opcodes */
+    if(ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED || io_uring_probe_ops(ring) == e_failure)
+    {
+        if(ring->sqes != MAP_FAILED)
+        {
+            munmap(ring->sqes, ring->sqes_size);
+        }
+        if(ring->cq_ring != MAP_FAILED && ring->cq_ring != ring->sq_ring)
+        {
+            munmap(ring->cq_ring, ring->cq_ring_size);
+        }
+        munmap(ring->sq_ring, ring->sq_ring_size);
+        close(ring->fd);
+        return e_failure;
+    }
+
+    ring->sq_head = (unsigned *) ((char *) ring->sq_ring + p.sq_off.head);
+    ring->sq_tail = (unsigned *) ((char *) ring->sq_ring + p.sq_off.tail);
+    ring->sq_mask = (unsigned *) ((char *) ring->sq_ring + p.sq_off.ring_mask);
+    ring->sq_array = (unsigned *) ((char *) ring->sq_ring + p.sq_off.array);
+    ring->cq_head = (unsigned *) ((char *) ring->cq_ring + p.cq_off.head);
+    ring->cq_tail = (unsigned *) ((char *) ring->cq_ring + p.cq_off.tail);
+    ring->cq_mask = (unsigned *) ((char *) ring->cq_ring + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) ((char *) ring->cq_ring + p.cq_off.cqes);
+
+    return e_success;
+}
+
+/* Unmap the rings */
+static void io_uring_close(IoUring *ring)
+{
+    munmap(ring->sqes, ring->sqes_size);
+    if(ring->cq_ring != ring->sq_ring)
+    {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+}
+
+/* Queue one read or write of a chunk and submit it */
+static Status io_uring_submit(IoEngine *io, uint slot, int op)
+{
+    IoUring *ring = &io->ring;
+    IoChunk *chunk = &io->chunks[slot];
+    unsigned tail = *ring->sq_tail;
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+
+    memset(sqe, 0, sizeof (*sqe));
+    sqe->opcode = op == IO_OP_READ ? IORING_OP_READ : IORING_OP_WRITE;
+    sqe->fd = op == IO_OP_READ ? io->fd_in : io->fd_out;
+    sqe->addr = (unsigned long) (chunk->buf + chunk->done);
+    sqe->len = chunk->len - chunk->done;
+    sqe->off = io->start + chunk->chunk_no * IO_CHUNK_SIZE + chunk->done;
+    sqe->user_data = (slot << 1) | op;
+
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    return syscall(__NR_io_uring_enter, ring->fd, 1, 0, 0, NULL, 0) == 1 ? e_success : e_failure;
+}
+
+/* Worker of the fallback pool, runs queued chunk operations with pread/pwrite */
+static void *io_pool_worker(void *arg)
+{
+    IoEngine *io = arg;
+    IoPool *pool = &io->pool;
+
+    pthread_mutex_lock(&pool->lock);
+    while(1)
+    {
+        while(pool->queue_len == 0 && !pool->stop)
+        {
+            pthread_cond_wait(&pool->work, &pool->lock);
+        }
+        if(pool->queue_len == 0)
+        {
+            break;
+        }
+
+        IoChunk *chunk = &io->chunks[pool->queue[--pool->queue_len]];
+        int is_read = chunk->state == e_chunk_reading;
+        long offset = io->start + chunk->chunk_no * IO_CHUNK_SIZE + chunk->done;
+        long result;
+
+        /* The blocking call runs without the lock */
+        pthread_mutex_unlock(&pool->lock);
+        if(is_read)
+        {
+            result = pread(io->fd_in, chunk->buf + chunk->done, chunk->len - chunk->done, offset);
+        }
+        else
+        {
+            result = pwrite(io->fd_out, chunk->buf + chunk->done, chunk->len - chunk->done, offset);
+        }
+        pthread_mutex_lock(&pool->lock);
+
+        chunk->result = result;
+        chunk->completed = 1;
+        pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+/* Stop and join the first count pool threads */
+static void io_pool_stop(IoEngine *io, int count)
+{
+    IoPool *pool = &io->pool;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+
+    for(int i = 0; i < count; i++)
+    {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->work);
+    pthread_mutex_destroy(&pool->lock);
+}
+
+/* Start the fallback pool */
+static Status io_pool_open(IoEngine *io)
+{
+    IoPool *pool = &io->pool;
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    for(int i = 0; i < IO_POOL_THREADS; i++)
+    {
+        /* Threads already started hold the engine, they are joined before it can be freed */
+        if(pthread_create(&pool->threads[i], NULL, io_pool_worker, io) != 0)
+        {
+            io_pool_stop(io, i);
+            return e_failure;
+        }
+    }
+
+    return e_success;
+}
+
+/* Stop the fallback pool */
+static void io_pool_close(IoEngine *io)
+{
+    io_pool_stop(io, IO_POOL_THREADS);
+}
+
+/* Hand one chunk operation to the backend, state must already say reading or writing */
+static Status io_submit(IoEngine *io, uint slot, int op)
+{
+    if(io->use_uring)
+    {
+        /* A chunk that never went out must not be waited for */
+        if(io_uring_submit(io, slot, op) == e_failure)
+        {
+            fprintf(stderr, "ERROR: I/O of chunk %ld could not be submitted\n", io->chunks[slot].chunk_no);
+            io->chunks[slot].state = e_chunk_eof;
+            return e_failure;
+        }
+        return e_success;
+    }
+
+    pthread_mutex_lock(&io->pool.lock);
+    io->chunks[slot].completed = 0;
+    io->pool.queue[io->pool.queue_len++] = slot;
+    pthread_cond_signal(&io->pool.work);
+    pthread_mutex_unlock(&io->pool.lock);
+
+    return e_success;
+}
+
+/* Schedule the read of a chunk into a free slot */
+static Status io_schedule_read(IoEngine *io, uint slot, long chunk_no)
+{
+    IoChunk *chunk = &io->chunks[slot];
+    long offset = io->start + chunk_no * IO_CHUNK_SIZE;
+
+    chunk->chunk_no = chunk_no;
+    if(offset >= io->end)
+    {
+        chunk->len = 0;
+        chunk->state = e_chunk_eof;
+        return e_success;
+    }
+
+    chunk->len = io->end - offset < IO_CHUNK_SIZE ? io->end - offset : IO_CHUNK_SIZE;
+    chunk->state = e_chunk_reading;
+
+    return io_submit(io, slot, IO_OP_READ);
+}
+
+/* Handle a finished operation, a written slot is reused for the chunk IO_QUEUE_DEPTH ahead */
+static Status io_complete(IoEngine *io, uint slot, long result)
+{
+    IoChunk *chunk = &io->chunks[slot];
+
+    if(result <= 0 || result > chunk->len - chunk->done)
+    {
+        fprintf(stderr, "ERROR: I/O of chunk %ld failed\n", chunk->chunk_no);
+        chunk->state = e_chunk_eof;
+        return e_failure;
+    }
+
+    /* A short transfer goes out again for the rest of the chunk, as stdio would retry it */
+    chunk->done += result;
+    if(chunk->done < chunk->len)
+    {
+        return io_submit(io, slot, chunk->state == e_chunk_reading ? IO_OP_READ : IO_OP_WRITE);
+    }
+    chunk->done = 0;
+
+    if(chunk->state == e_chunk_reading)
+    {
+        chunk->state = e_chunk_ready;
+        return e_success;
+    }
+
+    chunk->state = e_chunk_idle;
+    if(io->closing)
+    {
+        return e_success;
+    }
+
+    return io_schedule_read(io, slot, chunk->chunk_no + IO_QUEUE_DEPTH);
+}
+
+/* Wait for at least one operation to finish and handle it */
+static Status io_reap(IoEngine *io)
+{
+    if(io->use_uring)
+    {
+        IoUring *ring = &io->ring;
+        unsigned head = *ring->cq_head;
+
+        while(head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+        {
+            if(syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0)
+            {
+                return e_failure;
+            }
+        }
+
+        struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+        uint slot = cqe->user_data >> 1;
+        long result = cqe->res;
+
+        __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+
+        return io_complete(io, slot, result);
+    }
+
+    uint done[IO_QUEUE_DEPTH];
+    long results[IO_QUEUE_DEPTH];
+    uint count = 0;
+
+    pthread_mutex_lock(&io->pool.lock);
+    while(count == 0)
+    {
+        for(uint slot = 0; slot < IO_QUEUE_DEPTH; slot++)
+        {
+            if(io->chunks[slot].completed)
+            {
+                io->chunks[slot].completed = 0;
+                results[count] = io->chunks[slot].result;
+                done[count++] = slot;
+            }
+        }
+        if(count == 0)
+        {
+            pthread_cond_wait(&io->pool.done, &io->pool.lock);
+        }
+    }
+    pthread_mutex_unlock(&io->pool.lock);
+
+    /* Completions are handled on the engine thread, they may schedule more reads */
+    for(uint i = 0; i < count; i++)
+    {
+        if(io_complete(io, done[i], results[i]) == e_failure)
+        {
+            return e_failure;
+        }
+    }
+
+    return e_success;
+}
+
+/* Function definition to start streaming from offset */
+IoEngine *io_engine_open(FILE *fptr_in, FILE *fptr_out, long offset)
+{
+    IoEngine *io = calloc(1, sizeof (IoEngine));
+    struct stat st;
+    const char *pool_env;
+
+    if(io == NULL)
+    {
+        return NULL;
+    }
+
+    /* Everything buffered by stdio before the span must reach the file first */
+    if(fptr_out != NULL)
+    {
+        fflush(fptr_out);
+    }
+
+    io->fd_in = fileno(fptr_in);
+    io->fd_out = fptr_out != NULL ? fileno(fptr_out) : -1;
+    io->start = offset;
+    if(fstat(io->fd_in, &st) != 0)
+    {
+        free(io);
+        return NULL;
+    }
+    io->end = st.st_size;
+
+    for(uint slot = 0; slot < IO_QUEUE_DEPTH; slot++)
+    {
+        if(posix_memalign((void **) &io->chunks[slot].buf, 4096, IO_CHUNK_SIZE) != 0)
+        {
+            io_engine_close(io);
+            return NULL;
+        }
+    }
+
+    /* Prefer io_uring, fall back to the thread pool when the kernel refuses it or STEGO_IO_POOL is set */
+    pool_env = getenv("STEGO_IO_POOL");
+    io->use_uring = (pool_env == NULL || *pool_env == '\0') && io_uring_open(&io->ring) == e_success;
+    if(!io->use_uring)
+    {
+        printf("io_uring unavailable, using thread pool pread/pwrite\n");
+        if(io_pool_open(io) == e_failure)
+        {
+            io_engine_close(io);
+            return NULL;
+        }
+        io->pool_ready = 1;
+    }
+
+    /* Fill the pipeline */
+    for(uint slot = 0; slot < IO_QUEUE_DEPTH; slot++)
+    {
+        if(io_schedule_read(io, slot, slot) == e_failure)
+        {
+            io_engine_close(io);
+            return NULL;
+        }
+    }
+
+    return io;
+}
+
+/* Function definition to copy the next n input bytes into buf */
+uint io_engine_read(IoEngine *io, char *buf, uint n)
+{
+    uint done = 0;
+
+    while(done < n)
+    {
+        IoChunk *chunk = &io->chunks[io->rd_chunk % IO_QUEUE_DEPTH];
+        uint len;
+
+        /* Wait for the chunk to arrive, its slot may still be writing the chunk before */
+        while(chunk->state == e_chunk_reading || chunk->state == e_chunk_writing)
+        {
+            if(io_reap(io) == e_failure)
+            {
+                return done;
+            }
+        }
+        if(chunk->state != e_chunk_ready || chunk->chunk_no != io->rd_chunk)
+        {
+            break;
+        }
+
+        len = chunk->len - io->rd_pos;
+        if(len > n - done)
+        {
+            len = n - done;
+        }
+        memcpy(buf + done, chunk->buf + io->rd_pos, len);
+        io->rd_pos += len;
+        done += len;
+
+        if(io->rd_pos == chunk->len)
+        {
+            io->rd_chunk++;
+            io->rd_pos = 0;
+
+            /* Without an output the slot is free as soon as it is consumed */
+            if(io->fd_out < 0 &&
+               io_schedule_read(io, (io->rd_chunk - 1) % IO_QUEUE_DEPTH, io->rd_chunk - 1 + IO_QUEUE_DEPTH) == e_failure)
+            {
+                break;
+            }
+        }
+    }
+
+    return done;
+}
+
+/* Function definition to store the next n output bytes, a completed chunk is written behind */
+uint io_engine_write(IoEngine *io, const char *buf, uint n)
+{
+    uint done = 0;
+
+    while(done < n)
+    {
+        uint slot = io->wr_chunk % IO_QUEUE_DEPTH;
+        IoChunk *chunk = &io->chunks[slot];
+        uint len;
+
+        /* Output never runs ahead of input, the chunk has been read already */
+        if(chunk->state != e_chunk_ready || chunk->chunk_no != io->wr_chunk)
+        {
+            break;
+        }
+
+        len = chunk->len - io->wr_pos;
+        if(len > n - done)
+        {
+            len = n - done;
+        }
+        memcpy(chunk->buf + io->wr_pos, buf + done, len);
+        io->wr_pos += len;
+        done += len;
+
+        if(io->wr_pos == chunk->len)
+        {
+            chunk->state = e_chunk_writing;
+            io->wr_chunk++;
+            io->wr_pos = 0;
+            if(io_submit(io, slot, IO_OP_WRITE) == e_failure)
+            {
+                break;
+            }
+        }
+    }
+
+    return done;
+}
+
+/* Function definition to copy the rest of the input unchanged */
+Status io_engine_drain(IoEngine *io)
+{
+    char buf[4096];
+    uint n;
+
+    while((n = io_engine_read(io, buf, sizeof (buf))) > 0)
+    {
+        if(io->fd_out >= 0 && io_engine_write(io, buf, n) != n)
+        {
+            return e_failure;
+        }
+    }
+
+    return e_success;
+}
+
+/* Function definition to wait for pending operations and release the engine */
+Status io_engine_close(IoEngine *io)
+{
+    Status ret = e_success;
+    int pending = 1;
+
+    io->closing = 1;
+
+    /* A partly filled output chunk is written as it is */
+    if(io->fd_out >= 0 && io->wr_pos > 0)
+    {
+        IoChunk *chunk = &io->chunks[io->wr_chunk % IO_QUEUE_DEPTH];
+
+        chunk->len = io->wr_pos;
+        chunk->state = e_chunk_writing;
+        io->wr_pos = 0;
+        io_submit(io, io->wr_chunk % IO_QUEUE_DEPTH, IO_OP_WRITE);
+    }
+
+    while(pending && (io->use_uring || io->pool_ready))
+    {
+        pending = 0;
+        for(uint slot = 0; slot < IO_QUEUE_DEPTH; slot++)
+        {
+            if(io->chunks[slot].state == e_chunk_reading || io->chunks[slot].state == e_chunk_writing)
+            {
+                pending = 1;
+            }
+        }
+        if(pending && io_reap(io) == e_failure)
+        {
+            ret = e_failure;
+            break;
+        }
+    }
+
+    if(io->use_uring)
+    {
+        io_uring_close(&io->ring);
+    }
+    else if(io->pool_ready)
+    {
+        io_pool_close(io);
+    }
+
+    for(uint slot = 0; slot < IO_QUEUE_DEPTH; slot++)
+    {
+        free(io->chunks[slot].buf);
+    }
+    free(io);
+
+    return ret;
+}
@@ -0,0 +1,121 @@
+/* This file contains the function prototypes and structs for the asynchronous I/O engine */
+
+#ifndef IO_ENGINE_H
+#define IO_ENGINE_H
+
+#include <stdio.h>
+#include <pthread.h>
+#include "types.h" // Contains user defined types
+
+#define IO_CHUNK_SIZE (1 << 20)
+#define IO_QUEUE_DEPTH 3
+#define IO_POOL_THREADS 2
+
+/* I/O backend selected with --io */
+typedef enum
+{
+    e_io_sync,          // stdio, one request at a time
+    e_io_uring          // io_uring, thread pool pread/pwrite when unavailable
+} IoBackend;
+
+/* State of a chunk buffer */
+typedef enum
+{
+    e_chunk_idle,
+    e_chunk_reading,
+    e_chunk_ready,
+    e_chunk_writing,
+    e_chunk_eof
+} ChunkState;
+
+/* One pixel chunk buffer, chunk_no counts chunks from the start offset */
+typedef struct _IoChunk
+{
+    char *buf;
+    long chunk_no;
+    uint len;
+    uint done;              // Bytes a short read or write already moved
+    ChunkState state;
+
+    /* Result of an operation finished by a pool thread */
+    int completed;
+    long result;
+
+} IoChunk;
+
+/* Kernel io_uring rings, mapped without liburing */
+typedef struct _IoUring
+{
+    int fd;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+    void *sq_ring;
+    void *cq_ring;
+    size_t sq_ring_size;
+    size_t cq_ring_size;
+    size_t sqes_size;
+} IoUring;
+
+/* Fallback pool of threads doing blocking pread/pwrite */
+typedef struct _IoPool
+{
+    pthread_t threads[IO_POOL_THREADS];
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t done;
+    uint queue[IO_QUEUE_DEPTH];
+    uint queue_len;
+    int stop;
+} IoPool;
+
+/*
+ * Structure to stream a file from a start offset to its end,
+ * keeping IO_QUEUE_DEPTH chunks in flight. While one chunk is
+ * being embedded, the next is being read and the previous one
+ * written, so embedding overlaps with the disk transfer.
+ * Output chunks go to the same offsets of fd_out.
+ */
+typedef struct _IoEngine
+{
+    int fd_in;
+    int fd_out;             // -1 when only reading
+    long start;             // File offset of chunk 0
+    long end;               // Size of the input file
+    int use_uring;
+    int pool_ready;
+    int closing;            // No more reads are scheduled
+
+    IoChunk chunks[IO_QUEUE_DEPTH];
+    long rd_chunk;          // Chunk read_channels is consuming
+    uint rd_pos;
+    long wr_chunk;          // Chunk write_channels is filling
+    uint wr_pos;
+
+    IoUring ring;
+    IoPool pool;
+
+} IoEngine;
+
+/* Start streaming fptr_in (and fptr_out) from offset */
+IoEngine *io_engine_open(FILE *fptr_in, FILE *fptr_out, long offset);
+
+/* Copy the next n bytes of the input into buf */
+uint io_engine_read(IoEngine *io, char *buf, uint n);
+
+/* Store the next n bytes of the output */
+uint io_engine_write(IoEngine *io, const char *buf, uint n);
+
+/* Copy the rest of the input to the output unchanged */
+Status io_engine_drain(IoEngine *io);
+
+/* Wait for pending writes and release the engine */
+Status io_engine_close(IoEngine *io);
+
+#endif
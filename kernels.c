@@ -0,0 +1,83 @@
+/* This file contains the runtime selection of the bit kernels */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "kernels.h"
+#include "types.h"
+
+/*
+ * The build defines STEGO_KERNEL_<ISA> for every kernel object
+ * compiled with its instruction set. A plain build without them
+ * still gets SSE2 on x86-64, where it is part of the base ISA.
+ */
+#if defined(__SSE2__) && !defined(STEGO_KERNEL_SSE2)
+#define STEGO_KERNEL_SSE2
+#endif
+
+static const LsbKernels *selected_kernels;
+static pthread_once_t select_once = PTHREAD_ONCE_INIT;
+
+/* Function Definitions */
+
+/* Function definition to find kernels by name that this CPU can run */
+const LsbKernels *lsb_kernels_by_name(const char *name)
+{
+    if(strcmp(name, lsb_kernels_generic.name) == 0)
+    {
+        return &lsb_kernels_generic;
+    }
+#ifdef STEGO_KERNEL_SSE2
+    if(strcmp(name, "sse2") == 0 && __builtin_cpu_supports("sse2"))
+    {
+        return &lsb_kernels_sse2;
+    }
+#endif
+#ifdef STEGO_KERNEL_AVX2
+    if(strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2"))
+    {
+        return &lsb_kernels_avx2;
+    }
+#endif
+#ifdef STEGO_KERNEL_AVX512
+    if(strcmp(name, "avx512") == 0 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+    {
+        return &lsb_kernels_avx512;
+    }
+#endif
+
+    return NULL;
+}
+
+/* Pick the widest kernels the CPU runs, unless STEGO_KERNEL names others */
+static void select_kernels(void)
+{
+    static const char *const preferred[] = { "avx512", "avx2", "sse2", "generic", NULL };
+    const char *name = getenv("STEGO_KERNEL");
+
+    __builtin_cpu_init();
+
+    if(name != NULL && *name != '\0')
+    {
+        selected_kernels = lsb_kernels_by_name(name);
+        if(selected_kernels != NULL)
+        {
+            return;
+        }
+        fprintf(stderr, "WARNING: %s kernels are not available, picking the best ones\n", name);
+    }
+
+    for(int i = 0; selected_kernels == NULL; i++)
+    {
+        selected_kernels = lsb_kernels_by_name(preferred[i]);
+    }
+}
+
+/* Function definition to get the kernels in use */
+const LsbKernels *lsb_kernels(void)
+{
+    pthread_once(&select_once, select_kernels);
+
+    return selected_kernels;
+}
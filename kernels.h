@@ -0,0 +1,38 @@
+/* This file contains the bit kernels and their runtime selection */
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include "types.h" // Contains user defined types
+
+/*
+ * Bit kernels for one instruction set.
+ * Every payload byte maps to 8 channel bytes, its MSB in the LSB
+ * of the first one. The kernels take whole buffers and do no
+ * checks, the callers validate sizes first.
+ */
+typedef struct _LsbKernels
+{
+    const char *name;
+
+    /* Put the bits of count payload bytes into the LSBs of 8 * count channel bytes */
+    void (*embed)(char *channels, const char *payload, uint count);
+
+    /* Gather count payload bytes from the LSBs of 8 * count channel bytes */
+    void (*extract)(char *payload, const char *channels, uint count);
+
+} LsbKernels;
+
+/* Kernels of every instruction set, each built in an object of its own */
+extern const LsbKernels lsb_kernels_generic;
+extern const LsbKernels lsb_kernels_sse2;
+extern const LsbKernels lsb_kernels_avx2;
+extern const LsbKernels lsb_kernels_avx512;
+
+/* Best kernels for this CPU, or the ones named by STEGO_KERNEL */
+const LsbKernels *lsb_kernels(void);
+
+/* Kernels by name, NULL when not built in or not supported by this CPU */
+const LsbKernels *lsb_kernels_by_name(const char *name);
+
+#endif
@@ -0,0 +1,66 @@
+/* This file contains the AVX2 bit kernels, built with -mavx2 */
+
+#include <string.h>
+#include "kernels.h"
+#include "types.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+
+/* Function Definitions */
+
+/* Function definition to put payload bits into LSBs, 4 payload bytes per vector */
+static void embed_avx2(char *channels, const char *payload, uint count)
+{
+    const __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                                            2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+    const __m256i bit_mask = _mm256_set1_epi64x(0x0102040810204080LL);
+    const __m256i lsb_clear = _mm256_set1_epi8((char) 0xFE);
+    const __m256i one = _mm256_set1_epi8(1);
+    uint i = 0;
+
+    for(; i + 4 <= count; i += 4)
+    {
+        int word;
+        __m256i data;
+        __m256i c = _mm256_loadu_si256((const __m256i *) (channels + 8 * i));
+
+        /* Each payload byte repeated 8 times, then one bit of it kept per channel byte */
+        memcpy(&word, payload + i, 4);
+        data = _mm256_shuffle_epi8(_mm256_set1_epi32(word), spread);
+        data = _mm256_cmpeq_epi8(_mm256_and_si256(data, bit_mask), bit_mask);
+
+        c = _mm256_or_si256(_mm256_and_si256(c, lsb_clear), _mm256_and_si256(data, one));
+        _mm256_storeu_si256((__m256i *) (channels + 8 * i), c);
+    }
+
+    lsb_kernels_generic.embed(channels + 8 * i, payload + i, count - i);
+}
+
+/* Function definition to gather payload bytes from LSBs, 4 payload bytes per vector */
+static void extract_avx2(char *payload, const char *channels, uint count)
+{
+    /* Channel bytes of every payload byte reversed, so movemask puts the first one in its MSB */
+    const __m256i reverse = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                                             7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    uint i = 0;
+
+    for(; i + 4 <= count; i += 4)
+    {
+        __m256i c = _mm256_loadu_si256((const __m256i *) (channels + 8 * i));
+        int mask = _mm256_movemask_epi8(_mm256_slli_epi64(_mm256_shuffle_epi8(c, reverse), 7));
+
+        memcpy(payload + i, &mask, 4);
+    }
+
+    lsb_kernels_generic.extract(payload + i, channels + 8 * i, count - i);
+}
+
+const LsbKernels lsb_kernels_avx2 =
+{
+    .name = "avx2",
+    .embed = embed_avx2,
+    .extract = extract_avx2,
+};
+
+#endif
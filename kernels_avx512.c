@@ -0,0 +1,67 @@
+/* This file contains the AVX-512 bit kernels, built with -mavx512f -mavx512bw */
+
+#include <string.h>
+#include "kernels.h"
+#include "types.h"
+
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+#include <immintrin.h>
+
+/* Function Definitions */
+
+/* Function definition to put payload bits into LSBs, 8 payload bytes per vector */
+static void embed_avx512(char *channels, const char *payload, uint count)
+{
+    const __m512i spread = _mm512_set_epi64(0x0707070707070707LL, 0x0606060606060606LL, 0x0505050505050505LL, 0x0404040404040404LL,
+                                            0x0303030303030303LL, 0x0202020202020202LL, 0x0101010101010101LL, 0x0000000000000000LL);
+    const __m512i bit_mask = _mm512_set1_epi64(0x0102040810204080LL);
+    const __m512i lsb_clear = _mm512_set1_epi8((char) 0xFE);
+    const __m512i one = _mm512_set1_epi8(1);
+    uint i = 0;
+
+    for(; i + 8 <= count; i += 8)
+    {
+        long long word;
+        __mmask64 bits;
+        __m512i c = _mm512_loadu_si512((const void *) (channels + 8 * i));
+
+        /* Each payload byte repeated 8 times, its bits tested straight into a mask */
+        memcpy(&word, payload + i, 8);
+        bits = _mm512_test_epi8_mask(_mm512_shuffle_epi8(_mm512_set1_epi64(word), spread), bit_mask);
+
+        c = _mm512_and_si512(c, lsb_clear);
+        c = _mm512_mask_blend_epi8(bits, c, _mm512_or_si512(c, one));
+        _mm512_storeu_si512((void *) (channels + 8 * i), c);
+    }
+
+    lsb_kernels_generic.embed(channels + 8 * i, payload + i, count - i);
+}
+
+/* Function definition to gather payload bytes from LSBs, 8 payload bytes per vector */
+static void extract_avx512(char *payload, const char *channels, uint count)
+{
+    /* Channel bytes of every payload byte reversed, so the mask has the first one in the MSB */
+    const __m512i reverse = _mm512_set_epi64(0x08090A0B0C0D0E0FLL, 0x0001020304050607LL, 0x08090A0B0C0D0E0FLL, 0x0001020304050607LL,
+                                             0x08090A0B0C0D0E0FLL, 0x0001020304050607LL, 0x08090A0B0C0D0E0FLL, 0x0001020304050607LL);
+    const __m512i one = _mm512_set1_epi8(1);
+    uint i = 0;
+
+    for(; i + 8 <= count; i += 8)
+    {
+        __m512i c = _mm512_loadu_si512((const void *) (channels + 8 * i));
+        unsigned long long mask = _mm512_test_epi8_mask(_mm512_shuffle_epi8(c, reverse), one);
+
+        memcpy(payload + i, &mask, 8);
+    }
+
+    lsb_kernels_generic.extract(payload + i, channels + 8 * i, count - i);
+}
+
+const LsbKernels lsb_kernels_avx512 =
+{
+    .name = "avx512",
+    .embed = embed_avx512,
+    .extract = extract_avx512,
+};
+
+#endif
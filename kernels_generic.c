@@ -0,0 +1,40 @@
+/* This file contains the portable bit kernels */
+
+#include "kernels.h"
+#include "types.h"
+
+/* Function Definitions */
+
+/* Function definition to put payload bits into LSBs, 8 channel bytes per payload byte */
+static void embed_generic(char *channels, const char *payload, uint count)
+{
+    for(uint i = 0; i < count; i++)
+    {
+        char *p = channels + 8 * i;
+        unsigned char data = payload[i];
+
+        for(int j = 0; j < 8; j++)
+        {
+            p[j] = (p[j] & 0xFE) | ((data >> (7 - j)) & 1);
+        }
+    }
+}
+
+/* Function definition to gather payload bytes from LSBs */
+static void extract_generic(char *payload, const char *channels, uint count)
+{
+    for(uint i = 0; i < count; i++)
+    {
+        const char *p = channels + 8 * i;
+
+        payload[i] = (p[0] & 1) << 7 | (p[1] & 1) << 6 | (p[2] & 1) << 5 | (p[3] & 1) << 4 |
+                     (p[4] & 1) << 3 | (p[5] & 1) << 2 | (p[6] & 1) << 1 | (p[7] & 1);
+    }
+}
+
+const LsbKernels lsb_kernels_generic =
+{
+    .name = "generic",
+    .embed = embed_generic,
+    .extract = extract_generic,
+};
@@ -0,0 +1,69 @@
+/* This file contains the SSE2 bit kernels, built with -msse2 */
+
+#include "kernels.h"
+#include "types.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+
+/* Function Definitions */
+
+/* Function definition to put payload bits into LSBs, 2 payload bytes per vector */
+static void embed_sse2(char *channels, const char *payload, uint count)
+{
+    const __m128i bit_mask = _mm_set_epi8(1, 2, 4, 8, 16, 32, 64, (char) 128, 1, 2, 4, 8, 16, 32, 64, (char) 128);
+    const __m128i lsb_clear = _mm_set1_epi8((char) 0xFE);
+    const __m128i one = _mm_set1_epi8(1);
+    uint i = 0;
+
+    for(; i + 2 <= count; i += 2)
+    {
+        /* Each payload byte repeated 8 times, then one bit of it kept per channel byte */
+        __m128i data = _mm_cvtsi32_si128((unsigned char) payload[i] | (unsigned char) payload[i + 1] << 8);
+        __m128i c = _mm_loadu_si128((const __m128i *) (channels + 8 * i));
+
+        data = _mm_unpacklo_epi8(data, data);
+        data = _mm_unpacklo_epi16(data, data);
+        data = _mm_unpacklo_epi32(data, data);
+        data = _mm_cmpeq_epi8(_mm_and_si128(data, bit_mask), bit_mask);
+
+        c = _mm_or_si128(_mm_and_si128(c, lsb_clear), _mm_and_si128(data, one));
+        _mm_storeu_si128((__m128i *) (channels + 8 * i), c);
+    }
+
+    lsb_kernels_generic.embed(channels + 8 * i, payload + i, count - i);
+}
+
+/* Bits of a byte in reverse order, movemask puts the first channel byte in bit 0 */
+#define R2(n) n, n + 2 * 64, n + 1 * 64, n + 3 * 64
+#define R4(n) R2(n), R2(n + 2 * 16), R2(n + 1 * 16), R2(n + 3 * 16)
+#define R6(n) R4(n), R4(n + 2 * 4), R4(n + 1 * 4), R4(n + 3 * 4)
+
+static const unsigned char bit_reverse[256] = { R6(0), R6(2), R6(1), R6(3) };
+
+/* Function definition to gather payload bytes from LSBs, 2 payload bytes per vector */
+static void extract_sse2(char *payload, const char *channels, uint count)
+{
+    uint i = 0;
+
+    for(; i + 2 <= count; i += 2)
+    {
+        /* The LSB moved up to the sign bit of every byte, then collected */
+        __m128i c = _mm_loadu_si128((const __m128i *) (channels + 8 * i));
+        uint mask = _mm_movemask_epi8(_mm_slli_epi64(c, 7));
+
+        payload[i] = bit_reverse[mask & 0xFF];
+        payload[i + 1] = bit_reverse[mask >> 8];
+    }
+
+    lsb_kernels_generic.extract(payload + i, channels + 8 * i, count - i);
+}
+
+const LsbKernels lsb_kernels_sse2 =
+{
+    .name = "sse2",
+    .embed = embed_sse2,
+    .extract = extract_sse2,
+};
+
+#endif
@@ -0,0 +1,365 @@
+/* This file contains codes related to quality and steganalysis metrics */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "metrics.h"
+#include "types.h"
+
+#define CHI_MIN_EXPECTED 4
+#define GAMMA_EPS 1e-12
+#define GAMMA_ITERATIONS 500
+#define METRICS_HIST_SPLIT 256
+
+/* Function Definitions */
+
+/* Function definition to start accumulating */
+void metrics_init(StegoMetrics *metrics, uint lanes, uint row_len, uint row_stride)
+{
+    memset(metrics, 0, sizeof (StegoMetrics));
+    metrics->lanes = lanes > 0 && lanes <= METRICS_MAX_LANES ? lanes : 1;
+
+    /* Without a known geometry every byte is a sample */
+    if(row_len == 0)
+    {
+        row_len = row_stride = ~0u;
+    }
+    metrics->row_len = row_len;
+    metrics->row_stride = row_stride > row_len ? row_stride : row_len;
+}
+
+/* Discrimination function of RS analysis, the variation inside a group */
+static int rs_variation(const int *g)
+{
+    return abs(g[1] - g[0]) + abs(g[2] - g[1]) + abs(g[3] - g[2]);
+}
+
+/* Flipping F1 swaps 2k and 2k+1, F-1 swaps 2k-1 and 2k */
+static int rs_flip(int x, int negative)
+{
+    if(!negative)
+    {
+        return x ^ 1;
+    }
+
+    x = ((x + 1) ^ 1) - 1;
+
+    return x < 0 ? 0 : (x > 255 ? 255 : x);
+}
+
+/* Classify a group with the mask 0110 and its negative, add to rs[base..base+3] */
+static void rs_classify(unsigned long long *rs, const int *g)
+{
+    int f = rs_variation(g);
+
+    for(int negative = 0; negative < 2; negative++)
+    {
+        int flipped[RS_GROUP_SIZE] = { g[0], rs_flip(g[1], negative), rs_flip(g[2], negative), g[3] };
+        int f_flipped = rs_variation(flipped);
+
+        if(f_flipped > f)
+            rs[negative ? e_rs_regular_neg : e_rs_regular]++;
+        else if(f_flipped < f)
+            rs[negative ? e_rs_singular_neg : e_rs_singular]++;
+    }
+}
+
+/* Classify a completed group as it is and with all LSBs flipped */
+static void rs_add_group(StegoMetrics *metrics, const unsigned char *group)
+{
+    int g[RS_GROUP_SIZE];
+    int g_flipped[RS_GROUP_SIZE];
+
+    for(int i = 0; i < RS_GROUP_SIZE; i++)
+    {
+        g[i] = group[i];
+        g_flipped[i] = group[i] ^ 1;
+    }
+
+    rs_classify(metrics->rs, g);
+    rs_classify(metrics->rs + e_rs_count / 2, g_flipped);
+    metrics->rs_groups++;
+}
+
+/* Feed sample bytes of one row to the detectors */
+static void metrics_add_samples(StegoMetrics *metrics, const unsigned char *stego, uint n)
+{
+    /* Four partial tables keep consecutive equal bytes from waiting on each other */
+    uint partial[4][256];
+    uint i = 0;
+
+    /* Short writes of the embed pass go straight to the histogram */
+    if(n < METRICS_HIST_SPLIT)
+    {
+        for(; i < n; i++)
+        {
+            metrics->histogram[stego[i]]++;
+        }
+    }
+    else
+    {
+        memset(partial, 0, sizeof (partial));
+        for(; i + 4 <= n; i += 4)
+        {
+            partial[0][stego[i]]++;
+            partial[1][stego[i + 1]]++;
+            partial[2][stego[i + 2]]++;
+            partial[3][stego[i + 3]]++;
+        }
+        for(; i < n; i++)
+        {
+            partial[0][stego[i]]++;
+        }
+        for(int v = 0; v < 256; v++)
+        {
+            metrics->histogram[v] += partial[0][v] + partial[1][v] + partial[2][v] + partial[3][v];
+        }
+    }
+
+    /* RS groups per lane */
+    for(i = 0; i < n; i++)
+    {
+        uint lane = metrics->lane;
+
+        metrics->group[lane][metrics->group_len[lane]++] = stego[i];
+        if(metrics->group_len[lane] == RS_GROUP_SIZE)
+        {
+            rs_add_group(metrics, metrics->group[lane]);
+            metrics->group_len[lane] = 0;
+        }
+
+        metrics->lane = lane + 1 == metrics->lanes ? 0 : lane + 1;
+    }
+}
+
+/* Function definition to add n channel bytes */
+void metrics_update(StegoMetrics *metrics, const unsigned char *cover, const unsigned char *stego, uint n)
+{
+    /* Quality, a branch free loop the compiler vectorizes */
+    if(cover != NULL)
+    {
+        unsigned long long sq_error = 0;
+        unsigned long long changed = 0;
+
+        for(uint i = 0; i < n; i++)
+        {
+            int diff = (int) stego[i] - (int) cover[i];
+
+            sq_error += diff * diff;
+            changed += diff != 0;
+        }
+        metrics->sq_error += sq_error;
+        metrics->changed += changed;
+    }
+    metrics->samples += n;
+
+    /* Split the chunk into row samples and row padding */
+    while(n > 0)
+    {
+        uint len;
+
+        if(metrics->row_pos < metrics->row_len)
+        {
+            len = metrics->row_len - metrics->row_pos;
+            len = len < n ? len : n;
+            metrics_add_samples(metrics, stego, len);
+        }
+        else
+        {
+            len = metrics->row_stride - metrics->row_pos;
+            len = len < n ? len : n;
+        }
+
+        stego += len;
+        n -= len;
+        metrics->row_pos += len;
+        if(metrics->row_pos == metrics->row_stride)
+        {
+            metrics->row_pos = 0;
+        }
+    }
+}
+
+/* Regularized upper incomplete gamma function Q(a, x) */
+static double gamma_q(double a, double x)
+{
+    double gln = lgamma(a);
+
+    if(x <= 0)
+    {
+        return 1.0;
+    }
+
+    /* Series for P(a, x) */
+    if(x < a + 1)
+    {
+        double ap = a;
+        double sum = 1.0 / a;
+        double del = sum;
+
+        for(int i = 0; i < GAMMA_ITERATIONS; i++)
+        {
+            ap += 1;
+            del *= x / ap;
+            sum += del;
+            if(fabs(del) < fabs(sum) * GAMMA_EPS)
+            {
+                break;
+            }
+        }
+
+        return 1.0 - sum * exp(-x + a * log(x) - gln);
+    }
+
+    /* Continued fraction for Q(a, x) */
+    double b = x + 1 - a;
+    double c = 1.0 / 1e-300;
+    double d = 1.0 / b;
+    double h = d;
+
+    for(int i = 1; i <= GAMMA_ITERATIONS; i++)
+    {
+        double an = -i * (i - a);
+
+        b += 2;
+        d = an * d + b;
+        if(fabs(d) < 1e-300)
+            d = 1e-300;
+        c = b + an / c;
+        if(fabs(c) < 1e-300)
+            c = 1e-300;
+        d = 1.0 / d;
+        h *= d * c;
+        if(fabs(d * c - 1) < GAMMA_EPS)
+        {
+            break;
+        }
+    }
+
+    return exp(-x + a * log(x) - gln) * h;
+}
+
+/*
+ * Chi-square attack (Westfeld and Pfitzmann)
+ * LSB embedding equalizes the counts of each pair of values 2k, 2k+1.
+ * The statistic compares the even counts with the pair means, and the
+ * returned p is close to 1 when the pairs look equalized.
+ */
+static double chi_square_attack(const unsigned long long *histogram, double *chi_square)
+{
+    double chi = 0;
+    int categories = 0;
+
+    for(int k = 0; k < 128; k++)
+    {
+        double expected = (histogram[2 * k] + histogram[2 * k + 1]) / 2.0;
+
+        if(expected > CHI_MIN_EXPECTED)
+        {
+            double diff = histogram[2 * k] - expected;
+
+            chi += diff * diff / expected;
+            categories++;
+        }
+    }
+
+    *chi_square = chi;
+    if(categories < 2)
+    {
+        return 0;
+    }
+
+    return gamma_q((categories - 1) / 2.0, chi / 2.0);
+}
+
+/*
+ * RS analysis (Fridrich, Goljan and Du)
+ * Regular and singular group counts for the masks M and -M, taken on
+ * the image and on the image with all LSBs flipped, give a quadratic
+ * whose smaller root estimates the embedding rate.
+ */
+static double rs_estimate(const StegoMetrics *metrics)
+{
+    const unsigned long long *rs = metrics->rs;
+    const unsigned long long *rs_flipped = metrics->rs + e_rs_count / 2;
+    double d0, d1, dn0, dn1, a, b, c, z, disc;
+
+    if(metrics->rs_groups == 0)
+    {
+        return 0;
+    }
+
+    d0 = ((double) rs[e_rs_regular] - rs[e_rs_singular]) / metrics->rs_groups;
+    d1 = ((double) rs_flipped[e_rs_regular] - rs_flipped[e_rs_singular]) / metrics->rs_groups;
+    dn0 = ((double) rs[e_rs_regular_neg] - rs[e_rs_singular_neg]) / metrics->rs_groups;
+    dn1 = ((double) rs_flipped[e_rs_regular_neg] - rs_flipped[e_rs_singular_neg]) / metrics->rs_groups;
+
+    a = 2 * (d1 + d0);
+    b = dn0 - dn1 - d1 - 3 * d0;
+    c = d0 - dn0;
+
+    if(fabs(a) < 1e-12)
+    {
+        if(fabs(b) < 1e-12)
+        {
+            return 0;
+        }
+        z = -c / b;
+    }
+    else
+    {
+        disc = b * b - 4 * a * c;
+        if(disc < 0)
+        {
+            return 0;
+        }
+
+        double z1 = (-b + sqrt(disc)) / (2 * a);
+        double z2 = (-b - sqrt(disc)) / (2 * a);
+
+        z = fabs(z1) < fabs(z2) ? z1 : z2;
+    }
+
+    if(fabs(z - 0.5) < 1e-12)
+    {
+        return 1;
+    }
+
+    z = z / (z - 0.5);
+
+    return z < 0 ? 0 : (z > 1 ? 1 : z);
+}
+
+/* Function definition to work out the final figures */
+void metrics_report(const StegoMetrics *metrics, MetricsReport *report)
+{
+    memset(report, 0, sizeof (MetricsReport));
+    report->samples = metrics->samples;
+    report->changed = metrics->changed;
+
+    if(metrics->samples > 0)
+    {
+        report->mse = (double) metrics->sq_error / metrics->samples;
+    }
+    report->psnr = report->mse > 0 ? 10 * log10(255.0 * 255.0 / report->mse) : INFINITY;
+
+    report->chi_p = chi_square_attack(metrics->histogram, &report->chi_square);
+    report->rs_rate = rs_estimate(metrics);
+}
+
+/* Function definition to print the figures on one line */
+void metrics_print(const char *label, const MetricsReport *report, int with_cover)
+{
+    if(with_cover)
+    {
+        printf("%s samples=%llu changed=%llu mse=%.6f psnr=%.2f chi_square=%.2f chi_p=%.4f rs_rate=%.4f\n",
+               label, report->samples, report->changed, report->mse, report->psnr,
+               report->chi_square, report->chi_p, report->rs_rate);
+    }
+    else
+    {
+        printf("%s samples=%llu chi_square=%.2f chi_p=%.4f rs_rate=%.4f\n",
+               label, report->samples, report->chi_square, report->chi_p, report->rs_rate);
+    }
+}
@@ -0,0 +1,85 @@
+/* This file contains the function prototypes and structs for quality and steganalysis metrics */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "types.h" // Contains user defined types
+
+#define METRICS_BUF_SIZE 4096
+#define RS_GROUP_SIZE 4
+#define METRICS_MAX_LANES 4
+
+/* RS analysis counters, the second half is for the image with every LSB flipped */
+enum
+{
+    e_rs_regular,               // R_M
+    e_rs_singular,              // S_M
+    e_rs_regular_neg,           // R_-M
+    e_rs_singular_neg,          // S_-M
+    e_rs_count = 8
+};
+
+/*
+ * Structure to accumulate metrics over a stream of channel bytes.
+ * It is updated chunk by chunk, so the image is only read once.
+ * RS groups are formed from consecutive samples of the same
+ * channel (lane), carried over chunk boundaries.
+ * Quality figures cover every span byte, padding included,
+ * while the detectors only look at sample bytes.
+ */
+typedef struct _StegoMetrics
+{
+    uint lanes;
+    uint lane;                  // Lane of the next byte
+
+    /* Row padding of the span is left out of the detectors */
+    uint row_len;               // Sample bytes in a row
+    uint row_stride;            // Span bytes from one row to the next
+    uint row_pos;               // Position of the next byte in its row
+
+    /* Quality against the cover */
+    unsigned long long samples;
+    unsigned long long changed;
+    unsigned long long sq_error;
+
+    /* Chi-square attack on pairs of values */
+    unsigned long long histogram[256];
+
+    /* RS analysis */
+    unsigned long long rs[e_rs_count];
+    unsigned long long rs_groups;
+    unsigned char group[METRICS_MAX_LANES][RS_GROUP_SIZE];
+    uint group_len[METRICS_MAX_LANES];
+
+    /* Cover bytes of the last read, compared with the bytes written back */
+    unsigned char cover_buf[METRICS_BUF_SIZE];
+    uint cover_len;
+
+} StegoMetrics;
+
+/* Final figures */
+typedef struct _MetricsReport
+{
+    unsigned long long samples;
+    unsigned long long changed;
+    double mse;
+    double psnr;                // dB, infinite when nothing changed
+    double chi_square;
+    double chi_p;               // Probability of embedding from the chi-square attack
+    double rs_rate;             // Estimated share of samples carrying a message bit
+
+} MetricsReport;
+
+/* Start accumulating, lanes is the number of channels per pixel */
+void metrics_init(StegoMetrics *metrics, uint lanes, uint row_len, uint row_stride);
+
+/* Add n channel bytes, cover may be NULL when only the stego image is known */
+void metrics_update(StegoMetrics *metrics, const unsigned char *cover, const unsigned char *stego, uint n);
+
+/* Work out the final figures */
+void metrics_report(const StegoMetrics *metrics, MetricsReport *report);
+
+/* Print the figures on one line */
+void metrics_print(const char *label, const MetricsReport *report, int with_cover);
+
+#endif
@@ -0,0 +1,173 @@
+/* This file contains codes related to capacity planning */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "plan.h"
+#include "encode.h"
+#include "types.h"
+#include "cover.h"
+#include "common.h"
+
+/* Function Definitions */
+/* Validating the files given through CLA */
+Status read_and_validate_plan_args(char *argv[], PlanInfo *planInfo)
+{
+    struct stat st;
+
+	/* Checking if .txt secret file passed */
+    if(argv[2] == NULL || strrchr(argv[2], '.') == NULL || strcmp(strrchr(argv[2], '.'), ".txt") != 0)
+    {
+        return e_failure;
+    }
+    planInfo -> secret_fname = argv[2];
+
+	/* Only the size of the secret is needed, the file is never opened */
+    if(stat(planInfo -> secret_fname, &st) != 0)
+    {
+        perror("stat");
+        fprintf(stderr, "ERROR: Unable to stat file %s\n", planInfo -> secret_fname);
+        return e_failure;
+    }
+    planInfo -> size_secret_file = st.st_size;
+
+	/* Checking at least one cover image passed */
+    if(argv[3] == NULL)
+    {
+        return e_failure;
+    }
+    planInfo -> cover_fnames = &argv[3];
+
+    /* No failure return e_success */
+    return e_success;
+}
+
+/* Validating the covers and archive members given through CLA */
+Status read_and_validate_plan_archive_args(char *argv[], int archive_pos, PlanInfo *planInfo)
+{
+	/* At least one cover before --archive and one member after it */
+    if(archive_pos < 3 || argv[2] == NULL || argv[archive_pos] == NULL)
+    {
+        return e_failure;
+    }
+
+	/* The covers move down over -p so the list can end before the members */
+    for(int i = 2; i < archive_pos; i++)
+    {
+        argv[i - 1] = argv[i];
+    }
+    argv[archive_pos - 1] = NULL;
+    planInfo -> cover_fnames = &argv[1];
+    planInfo -> archive_fnames = &argv[archive_pos];
+    planInfo -> secret_fname = "archive";
+
+	/* The index is built as the encoder builds it, reading the members but no cover */
+    if(archive_build(&planInfo -> archive, planInfo -> archive_fnames) == e_failure)
+    {
+        return e_failure;
+    }
+    planInfo -> size_secret_file = planInfo -> archive.index_size + planInfo -> archive.data_size;
+
+    /* No failure return e_success */
+    return e_success;
+}
+
+/* 
+ * Work out the capacity of one cover
+ * Input: Cover image file name and the planned payload and layout
+ * Output: Exact capacity, overhead and payload of the cover
+ * Description: Only the cover header is read, the pixel
+ * span is never touched and no output file is created. The
+ * capacity comes from the function check_capacity uses.
+ */
+Status plan_cover_capacity(const char *cover_fname, const PlanInfo *planInfo, CapacityPlan *plan)
+{
+    int archive = planInfo -> archive_fnames != NULL;
+    CoverInfo cover;
+    FILE *fptr;
+    Status ret;
+
+    memset(plan, 0, sizeof (CapacityPlan));
+    plan -> payload = planInfo -> size_secret_file;
+
+    plan -> format = cover_format_for_fname(cover_fname);
+    if(plan -> format == NULL)
+    {
+        return e_failure;
+    }
+
+    fptr = fopen(cover_fname, "r");
+    if(fptr == NULL)
+    {
+        return e_failure;
+    }
+
+    ret = cover_parse_header(plan -> format, fptr, &cover);
+    fclose(fptr);
+    if(ret == e_failure)
+    {
+        return e_failure;
+    }
+
+    plan -> width = cover.width;
+    plan -> height = cover.height;
+    plan -> header_size = cover.pixel_offset;
+    plan -> pixel_span = cover.pixel_span;
+    plan -> overhead = get_encode_overhead() + (planInfo -> hamming_k != 0 || archive ? PARAM_BYTES : 0);
+
+	/* A span too small for the stego header fits nothing, not even an empty secret */
+    plan -> fits = get_layout_capacity(cover.pixel_span, planInfo -> hamming_k, archive, &plan -> capacity) == e_success &&
+                   plan -> payload <= plan -> capacity;
+
+    /* No failure return e_success */
+    return e_success;
+}
+
+/* Function definition for planning, prints one key=value line per cover */
+Status do_planning(PlanInfo *planInfo)
+{
+    CapacityPlan plan;
+
+	/* Adaptive capacity depends on the cover pixels, which the planner never reads */
+    if(check_layout_options(planInfo -> adaptive, planInfo -> hamming_k, planInfo -> archive_fnames != NULL) == e_failure)
+    {
+        return e_failure;
+    }
+    if(planInfo -> adaptive)
+    {
+        fprintf(stderr, "ERROR: Adaptive capacity depends on the cover pixels, plan with the plain or --hamming layout\n");
+        return e_failure;
+    }
+
+    /* The tool embeds the secret as it is, so the payload after compression is the file size */
+    if(planInfo -> archive_fnames != NULL)
+    {
+        printf("Archive of %u files: payload = %ld bytes\n", planInfo -> archive.count, planInfo -> size_secret_file);
+    }
+    else
+    {
+        printf("Secret file %s: payload = %ld bytes\n", planInfo -> secret_fname, planInfo -> size_secret_file);
+    }
+
+    for(int i = 0; planInfo -> cover_fnames[i] != NULL; i++)
+    {
+        if(plan_cover_capacity(planInfo -> cover_fnames[i], planInfo, &plan) == e_failure)
+        {
+            printf("cover=%s error=unsupported\n", planInfo -> cover_fnames[i]);
+            continue;
+        }
+
+        printf("cover=%s format=%s width=%u height=%u header=%ld span=%u overhead=%u capacity=%u payload=%ld fits=%s\n",
+               planInfo -> cover_fnames[i], plan.format -> name, plan.width, plan.height, plan.header_size,
+               plan.pixel_span, plan.overhead, plan.capacity, plan.payload, plan.fits ? "yes" : "no");
+    }
+
+    /* No failure return e_success */
+    return e_success;
+}
+
+/* Function definition to release the archive index built for planning */
+void close_plan(PlanInfo *planInfo)
+{
+    archive_free(&planInfo -> archive);
+}
@@ -0,0 +1,59 @@
+/* This file contains the function prototypes and structs required for capacity planning */
+
+#include <stdio.h>
+#ifndef PLAN_H
+#define PLAN_H
+
+#include "types.h" // Contains user defined types
+#include "cover.h" // Contains cover image formats
+#include "archive.h" // Contains the multi file archive
+
+/* struct for storing the planning request */
+typedef struct _PlanInfo
+{
+    /* Secret File Info */
+    char *secret_fname;
+    long size_secret_file;
+
+    /* Candidate cover images, NULL terminated */
+    char **cover_fnames;
+
+    /* Layout the covers are planned for, as given to -e */
+    int adaptive;
+    uint hamming_k;
+    char **archive_fnames;      // Members of an archive instead of the secret file
+    Archive archive;
+
+} PlanInfo;
+
+/* struct for storing the capacity of one cover */
+typedef struct _CapacityPlan
+{
+    const CoverFormat *format;
+    uint width;
+    uint height;
+    long header_size;       // Cover bytes before the pixel span
+    uint pixel_span;        // Channel bytes available for embedding
+    uint overhead;          // Bytes embedded besides the secret data
+    uint capacity;          // Secret data bytes that fit
+    long payload;           // Secret data bytes to embed
+    int fits;               // The encoder would accept the payload
+
+} CapacityPlan;
+
+/* Read and validate Plan args from argv */
+Status read_and_validate_plan_args(char *argv[], PlanInfo *planInfo);
+
+/* Read and validate Plan args for an archive, the covers come before the members */
+Status read_and_validate_plan_archive_args(char *argv[], int archive_pos, PlanInfo *planInfo);
+
+/* Work out the capacity of one cover reading only its header */
+Status plan_cover_capacity(const char *cover_fname, const PlanInfo *planInfo, CapacityPlan *plan);
+
+/* Release the archive index built for planning */
+void close_plan(PlanInfo *planInfo);
+
+/* Perform the planning */
+Status do_planning(PlanInfo *planInfo);
+
+#endif
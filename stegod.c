@@ -0,0 +1,521 @@
+/* This file contains codes related to the stegod daemon */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include "stegod.h"
+#include "encode.h"
+#include "decode.h"
+#include "types.h"
+
+/* Function Definitions */
+
+/* Function definition to send a message with descriptors attached */
+Status stegod_send(int sock, const char *msg, const int *fds, int nfds)
+{
+    char control[CMSG_SPACE(sizeof (int) * STEGOD_MAX_FDS)];
+    struct iovec iov = { (void *) msg, strlen(msg) };
+    struct msghdr hdr;
+
+    memset(&hdr, 0, sizeof (hdr));
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+
+    if(nfds > 0)
+    {
+        struct cmsghdr *cmsg;
+
+        memset(control, 0, sizeof (control));
+        hdr.msg_control = control;
+        hdr.msg_controllen = CMSG_SPACE(sizeof (int) * nfds);
+        cmsg = CMSG_FIRSTHDR(&hdr);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof (int) * nfds);
+        memcpy(CMSG_DATA(cmsg), fds, sizeof (int) * nfds);
+    }
+
+    return sendmsg(sock, &hdr, MSG_NOSIGNAL) == (ssize_t) iov.iov_len ? e_success : e_failure;
+}
+
+/* Function definition to receive one message line and its descriptors, fds holds STEGOD_MAX_FDS */
+Status stegod_recv(int sock, char *msg, uint size, int *fds, int *nfds)
+{
+    char control[CMSG_SPACE(sizeof (int) * STEGOD_MAX_FDS)];
+    uint len = 0;
+
+    *nfds = 0;
+    while(len == 0 || msg[len - 1] != '\n')
+    {
+        struct iovec iov = { msg + len, size - 1 - len };
+        struct msghdr hdr;
+        struct cmsghdr *cmsg;
+        ssize_t n;
+
+        if(len == size - 1)
+        {
+            return e_failure;
+        }
+
+        memset(&hdr, 0, sizeof (hdr));
+        hdr.msg_iov = &iov;
+        hdr.msg_iovlen = 1;
+        hdr.msg_control = control;
+        hdr.msg_controllen = sizeof (control);
+
+        n = recvmsg(sock, &hdr, MSG_CMSG_CLOEXEC);
+        if(n <= 0)
+        {
+            return e_failure;
+        }
+        len += n;
+
+        /* Descriptors ride along with the first bytes of the message */
+        for(cmsg = CMSG_FIRSTHDR(&hdr); cmsg != NULL; cmsg = CMSG_NXTHDR(&hdr, cmsg))
+        {
+            if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+            {
+                int count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof (int);
+                int *passed = (int *) CMSG_DATA(cmsg);
+
+                /* Keep at most STEGOD_MAX_FDS, close the rest */
+                for(int i = 0; i < count; i++)
+                {
+                    if(*nfds < STEGOD_MAX_FDS)
+                        fds[(*nfds)++] = passed[i];
+                    else
+                        close(passed[i]);
+                }
+            }
+        }
+    }
+
+    /* Strip the newline */
+    msg[len - 1] = '\0';
+
+    return e_success;
+}
+
+/* Split a request into its tab separated fields, -1 when there are too many to keep */
+static int stegod_split(char *msg, char *fields[])
+{
+    int count = 0;
+    char *save;
+
+    for(char *field = strtok_r(msg, "\t", &save); field != NULL; field = strtok_r(NULL, "\t", &save))
+    {
+        if(count == STEGOD_MAX_FIELDS)
+        {
+            return -1;
+        }
+        fields[count++] = field;
+    }
+    fields[count] = NULL;
+
+    return count;
+}
+
+/* Take the -- options out of the fields, leaving the paths in place, the embedding options are NULL for a decode */
+static Status stegod_options(char *fields[], int *adaptive, const char **key_phrase, uint *hamming_k)
+{
+    int j = 1;
+    int i;
+
+    for(i = 1; fields[i] != NULL; i++)
+    {
+        if(strncmp(fields[i], "--", 2) != 0)
+        {
+            fields[j++] = fields[i];
+        }
+        else if(adaptive != NULL && strcmp(fields[i], "--adaptive") == 0)
+        {
+            *adaptive = 1;
+        }
+        else if(strncmp(fields[i], "--key=", 6) == 0)
+        {
+            *key_phrase = fields[i] + 6;
+        }
+        else if(hamming_k != NULL && strncmp(fields[i], "--hamming=", 10) == 0)
+        {
+            *hamming_k = atoi(fields[i] + 10);
+            if(*hamming_k < HAMMING_MIN_K || *hamming_k > HAMMING_MAX_K)
+            {
+                fprintf(stderr, "ERROR: Hamming code k must be %d to %d\n", HAMMING_MIN_K, HAMMING_MAX_K);
+                return e_failure;
+            }
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: stegod does not support %s\n", fields[i]);
+            return e_failure;
+        }
+    }
+    while(j <= i)
+    {
+        fields[j++] = NULL;
+    }
+
+    return e_success;
+}
+
+/* Close descriptors a job did not take */
+static void stegod_close_fds(int *fds, int nfds)
+{
+    for(int i = 0; i < nfds; i++)
+    {
+        close(fds[i]);
+    }
+}
+
+/* Paths the daemon opens itself must not depend on its cwd */
+static Status stegod_check_path(const char *fname)
+{
+    if(fname == NULL || fname[0] != '/')
+    {
+        fprintf(stderr, "ERROR: stegod opens only absolute paths, pass %s as a descriptor or an absolute path\n",
+                fname != NULL ? fname : "the file");
+        return e_failure;
+    }
+
+    return e_success;
+}
+
+/* Run an encode job, the cover comes from the cache when possible */
+static Status stegod_encode(StegodInfo *stegod, char *fields[], int *fds, int nfds)
+{
+    char *argv[] = { "stegod", "-e", NULL, NULL, NULL, NULL };
+    CoverCacheEntry *entry = NULL;
+    EncodeInfo encInfo;
+    Status ret;
+    int cover_fd;
+
+    memset(&encInfo, 0, sizeof (encInfo));
+    encInfo.io_backend = stegod->io_backend;
+
+    if(stegod_options(fields, &encInfo.adaptive, &encInfo.key_phrase, &encInfo.hamming_k) == e_failure)
+    {
+        stegod_close_fds(fds, nfds);
+        return e_failure;
+    }
+
+    /* The paths are the fields left once the options are out */
+    argv[2] = fields[1];
+    argv[3] = fields[2];
+    argv[4] = fields[3];
+    if(fields[1] == NULL || fields[2] == NULL || read_and_validate_encode_args(argv, &encInfo) == e_failure)
+    {
+        stegod_close_fds(fds, nfds);
+        return e_failure;
+    }
+
+    /* Files not passed as descriptors are opened here, the default stego name included */
+    if((nfds < 1 && stegod_check_path(encInfo.src_image_fname) == e_failure) ||
+       (nfds < 2 && stegod_check_path(encInfo.secret_fname) == e_failure) ||
+       (nfds < 3 && stegod_check_path(encInfo.stego_image_fname) == e_failure))
+    {
+        stegod_close_fds(fds, nfds);
+        return e_failure;
+    }
+
+    /* Source image, passed by the client or opened here */
+    cover_fd = nfds > 0 ? fds[0] : open(encInfo.src_image_fname, O_RDONLY | O_CLOEXEC);
+    if(cover_fd >= 0)
+    {
+        entry = cover_cache_get(&stegod->cache, cover_fd);
+        if(entry != NULL)
+        {
+            encInfo.fptr_src_image = fmemopen(entry->data, entry->size, "r");
+            encInfo.cover_header = cover_cache_header(&stegod->cache, entry, encInfo.cover.format);
+            close(cover_fd);
+        }
+        else
+        {
+            encInfo.fptr_src_image = fdopen(cover_fd, "r");
+        }
+    }
+
+    if(nfds > 1)
+    {
+        encInfo.fptr_secret = fdopen(fds[1], "r");
+    }
+    if(nfds > 2)
+    {
+        encInfo.fptr_stego_image = fdopen(fds[2], "w");
+    }
+
+    ret = do_encoding(&encInfo);
+    close_files(&encInfo);
+
+    if(entry != NULL)
+    {
+        cover_cache_put(&stegod->cache, entry);
+    }
+
+    return ret;
+}
+
+/* Run a decode job */
+static Status stegod_decode(StegodInfo *stegod, char *fields[], int *fds, int nfds)
+{
+    char *argv[] = { "stegod", "-d", NULL, NULL, NULL };
+    DecodeInfo decInfo;
+    Status ret;
+
+    memset(&decInfo, 0, sizeof (decInfo));
+    decInfo.io_backend = stegod->io_backend;
+
+    if(stegod_options(fields, NULL, &decInfo.key_phrase, NULL) == e_failure)
+    {
+        stegod_close_fds(fds, nfds);
+        return e_failure;
+    }
+
+    argv[2] = fields[1];
+    argv[3] = fields[2];
+    if(fields[1] == NULL || read_and_validate_decode_args(argv, &decInfo) == e_failure)
+    {
+        stegod_close_fds(fds, nfds);
+        return e_failure;
+    }
+
+    if((nfds < 1 && stegod_check_path(decInfo.stego_image_fname) == e_failure) ||
+       (nfds < 2 && stegod_check_path(decInfo.decode_fname) == e_failure))
+    {
+        stegod_close_fds(fds, nfds);
+        return e_failure;
+    }
+
+    if(nfds > 0)
+    {
+        decInfo.fptr_stego_image = fdopen(fds[0], "r");
+    }
+    if(nfds > 1)
+    {
+        decInfo.fptr_decode_text = fdopen(fds[1], "w");
+    }
+
+    ret = do_decoding(&decInfo);
+    close_decode_files(&decInfo);
+
+    return ret;
+}
+
+/* Serve one connection */
+static void stegod_serve(StegodInfo *stegod, int conn)
+{
+    char msg[STEGOD_MSG_SIZE];
+    char *fields[STEGOD_MAX_FIELDS + 1] = { NULL };
+    int fds[STEGOD_MAX_FDS];
+    int nfds = 0;
+    Status ret = e_failure;
+
+    if(stegod_recv(conn, msg, sizeof (msg), fds, &nfds) == e_failure)
+    {
+        stegod_close_fds(fds, nfds);
+        stegod_send(conn, "ERR bad request\n", NULL, 0);
+        return;
+    }
+
+    if(stegod_split(msg, fields) <= 0)
+    {
+        fields[0] = "";
+    }
+
+    if(strcmp(fields[0], STEGOD_REQ_STATS) == 0)
+    {
+        char reply[STEGOD_MSG_SIZE];
+
+        stegod_close_fds(fds, nfds);
+        pthread_mutex_lock(&stegod->lock);
+        pthread_mutex_lock(&stegod->cache.lock);
+        snprintf(reply, sizeof (reply),
+                 "OK jobs=%lu failed=%lu rejected=%lu queued=%u cache_entries=%u cache_bytes=%zu cache_hits=%lu cache_dedups=%lu cache_misses=%lu cache_evictions=%lu\n",
+                 stegod->jobs_done, stegod->jobs_failed, stegod->jobs_rejected, stegod->queue_len,
+                 stegod->cache.entries, stegod->cache.bytes, stegod->cache.hits, stegod->cache.dedups,
+                 stegod->cache.misses, stegod->cache.evictions);
+        pthread_mutex_unlock(&stegod->cache.lock);
+        pthread_mutex_unlock(&stegod->lock);
+
+        stegod_send(conn, reply, NULL, 0);
+        return;
+    }
+
+    /* The jobs take ownership of the descriptors */
+    if(strcmp(fields[0], STEGOD_REQ_ENCODE) == 0)
+    {
+        ret = stegod_encode(stegod, fields, fds, nfds);
+    }
+    else if(strcmp(fields[0], STEGOD_REQ_DECODE) == 0)
+    {
+        ret = stegod_decode(stegod, fields, fds, nfds);
+    }
+    else
+    {
+        stegod_close_fds(fds, nfds);
+    }
+
+    pthread_mutex_lock(&stegod->lock);
+    if(ret == e_success)
+        stegod->jobs_done++;
+    else
+        stegod->jobs_failed++;
+    pthread_mutex_unlock(&stegod->lock);
+
+    stegod_send(conn, ret == e_success ? "OK\n" : "ERR job failed\n", NULL, 0);
+}
+
+/* Worker thread, takes connections off the queue */
+static void *stegod_worker(void *arg)
+{
+    StegodInfo *stegod = arg;
+
+    while(1)
+    {
+        int conn;
+
+        pthread_mutex_lock(&stegod->lock);
+        while(stegod->queue_len == 0)
+        {
+            pthread_cond_wait(&stegod->work, &stegod->lock);
+        }
+        conn = stegod->queue[stegod->queue_head];
+        stegod->queue_head = (stegod->queue_head + 1) % STEGOD_QUEUE_SIZE;
+        stegod->queue_len--;
+        pthread_mutex_unlock(&stegod->lock);
+
+        stegod_serve(stegod, conn);
+        close(conn);
+    }
+
+    return NULL;
+}
+
+/* Validating the args given through CLA */
+Status read_and_validate_daemon_args(char *argv[], StegodInfo *stegod)
+{
+    /* Checking socket path passed */
+    if(argv[2] == NULL || strlen(argv[2]) >= sizeof (((struct sockaddr_un *) 0)->sun_path))
+    {
+        return e_failure;
+    }
+    stegod -> socket_path = argv[2];
+
+    /* No failure return e_success */
+    return e_success;
+}
+
+/* Function definition for the daemon, accepts connections and queues them for the workers */
+Status do_daemon(StegodInfo *stegod)
+{
+    struct sockaddr_un addr;
+    struct timeval timeout = { STEGOD_RECV_TIMEOUT_MS / 1000, (STEGOD_RECV_TIMEOUT_MS % 1000) * 1000 };
+    mode_t old_mask;
+    int null_fd;
+    int ret;
+
+    signal(SIGPIPE, SIG_IGN);
+
+    if(pthread_mutex_init(&stegod->lock, NULL) != 0 || pthread_cond_init(&stegod->work, NULL) != 0 ||
+       cover_cache_init(&stegod->cache, STEGOD_CACHE_BYTES) == e_failure)
+    {
+        return e_failure;
+    }
+    stegod->queue_head = stegod->queue_len = 0;
+    stegod->jobs_done = stegod->jobs_failed = stegod->jobs_rejected = 0;
+
+    stegod->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(stegod->listen_fd < 0)
+    {
+        perror("socket");
+        return e_failure;
+    }
+
+    memset(&addr, 0, sizeof (addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, stegod->socket_path);
+    unlink(stegod->socket_path);
+
+    /* Jobs run with the daemon's privileges, so only its own user may connect */
+    old_mask = umask(0177);
+    ret = bind(stegod->listen_fd, (struct sockaddr *) &addr, sizeof (addr));
+    umask(old_mask);
+    if(ret != 0 || chmod(stegod->socket_path, 0600) != 0 || listen(stegod->listen_fd, STEGOD_QUEUE_SIZE) != 0)
+    {
+        perror("bind");
+        fprintf(stderr, "ERROR: Unable to listen on %s\n", stegod->socket_path);
+        return e_failure;
+    }
+
+    for(int i = 0; i < STEGOD_WORKERS; i++)
+    {
+        if(pthread_create(&stegod->workers[i], NULL, stegod_worker, stegod) != 0)
+        {
+            return e_failure;
+        }
+    }
+
+    printf("stegod listening on %s with %d workers\n", stegod->socket_path, STEGOD_WORKERS);
+    fflush(stdout);
+
+    /* Progress of concurrent jobs would interleave, only their errors on stderr are kept */
+    null_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    if(null_fd >= 0)
+    {
+        dup2(null_fd, STDOUT_FILENO);
+        close(null_fd);
+    }
+
+    while(1)
+    {
+        int conn = accept4(stegod->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        struct ucred cred;
+        socklen_t cred_len = sizeof (cred);
+
+        if(conn < 0)
+        {
+            continue;
+        }
+
+        /* Only the daemon's own user may submit jobs, whatever the socket mode ends up being */
+        if(getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len) != 0 || cred.uid != getuid())
+        {
+            pthread_mutex_lock(&stegod->lock);
+            stegod->jobs_rejected++;
+            pthread_mutex_unlock(&stegod->lock);
+            stegod_send(conn, "ERR permission denied\n", NULL, 0);
+            close(conn);
+            continue;
+        }
+
+        /* A stalled client must not hold a worker */
+        setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof (timeout));
+
+        pthread_mutex_lock(&stegod->lock);
+
+        /* Backpressure, a full queue turns new requests away */
+        if(stegod->queue_len == STEGOD_QUEUE_SIZE)
+        {
+            stegod->jobs_rejected++;
+            pthread_mutex_unlock(&stegod->lock);
+            stegod_send(conn, STEGOD_REPLY_BUSY "\n", NULL, 0);
+            close(conn);
+            continue;
+        }
+
+        stegod->queue[(stegod->queue_head + stegod->queue_len) % STEGOD_QUEUE_SIZE] = conn;
+        stegod->queue_len++;
+        pthread_cond_signal(&stegod->work);
+        pthread_mutex_unlock(&stegod->lock);
+    }
+
+    return e_success;
+}
@@ -0,0 +1,99 @@
+/* This file contains the function prototypes and structs for the stegod daemon and its client */
+
+#ifndef STEGOD_H
+#define STEGOD_H
+
+#include <pthread.h>
+#include "types.h" // Contains user defined types
+#include "io_engine.h" // Contains the I/O backends
+#include "cover_cache.h" // Contains the cover image cache
+
+#define STEGOD_WORKERS 4
+#define STEGOD_QUEUE_SIZE 16
+#define STEGOD_CACHE_BYTES (256UL << 20)
+#define STEGOD_MSG_SIZE 4096
+#define STEGOD_MAX_FDS 3
+#define STEGOD_MAX_FIELDS 8
+#define STEGOD_RETRIES 8
+#define STEGOD_RETRY_DELAY_MS 50
+#define STEGOD_RECV_TIMEOUT_MS 5000
+
+/*
+ * Requests are one line of tab separated fields:
+ *   ENCODE <src image> <secret> [<stego image>] [--adaptive] [--key=phrase] [--hamming=k]
+ *   DECODE <stego image> [<decode file>] [--key=phrase]
+ *   STATS
+ * Options follow the paths as fields of their own, an option the
+ * daemon does not know fails the request.
+ * The files may be passed as descriptors along with the request,
+ * in the order of the fields, otherwise the daemon opens the paths,
+ * which must then be absolute. Only the daemon's user may connect.
+ * The reply is one line starting with OK, ERR or BUSY. A client
+ * that does not send its request in time gets ERR and is dropped.
+ */
+#define STEGOD_REQ_ENCODE "ENCODE"
+#define STEGOD_REQ_DECODE "DECODE"
+#define STEGOD_REQ_STATS "STATS"
+#define STEGOD_REPLY_BUSY "BUSY"
+
+/* struct for storing the daemon state */
+typedef struct _StegodInfo
+{
+    /* Listening socket */
+    char *socket_path;
+    int listen_fd;
+
+    /* Worker pool and its bounded queue of connections */
+    pthread_t workers[STEGOD_WORKERS];
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    int queue[STEGOD_QUEUE_SIZE];
+    uint queue_head;
+    uint queue_len;
+
+    /* Warm covers shared by all jobs */
+    CoverCache cache;
+
+    /* I/O backend used by the jobs */
+    IoBackend io_backend;
+
+    /* Counters for the stats output */
+    unsigned long jobs_done;
+    unsigned long jobs_failed;
+    unsigned long jobs_rejected;
+
+} StegodInfo;
+
+/* struct for storing a client request */
+typedef struct _ClientInfo
+{
+    char *socket_path;
+    OperationType operation;
+    char **args;                // Positional args after -e/-d, NULL terminated
+
+    /* Embedding options forwarded with the request */
+    int adaptive;
+    const char *key_phrase;
+    uint hamming_k;
+
+} ClientInfo;
+
+/* Read and validate daemon args from argv */
+Status read_and_validate_daemon_args(char *argv[], StegodInfo *stegod);
+
+/* Serve requests until killed */
+Status do_daemon(StegodInfo *stegod);
+
+/* Read and validate client args from argv */
+Status read_and_validate_client_args(char *argv[], ClientInfo *client);
+
+/* Send one request to the daemon and report its reply */
+Status do_client(ClientInfo *client);
+
+/* Send a message with descriptors attached */
+Status stegod_send(int sock, const char *msg, const int *fds, int nfds);
+
+/* Receive one message line and the descriptors attached to it */
+Status stegod_recv(int sock, char *msg, uint size, int *fds, int *nfds);
+
+#endif
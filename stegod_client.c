@@ -0,0 +1,287 @@
+/* This file contains codes related to the stegod client */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "stegod.h"
+#include "encode.h"
+#include "decode.h"
+#include "types.h"
+
+/* Function Definitions */
+/* Validating the args given through CLA */
+Status read_and_validate_client_args(char *argv[], ClientInfo *client)
+{
+    /* Checking socket path passed */
+    if(argv[2] == NULL || strlen(argv[2]) >= sizeof (((struct sockaddr_un *) 0)->sun_path) || argv[3] == NULL)
+    {
+        return e_failure;
+    }
+    client -> socket_path = argv[2];
+
+	/* Same operations as the command line, -s asks for the daemon stats */
+    if(strcmp(argv[3], "-e") == 0)
+    {
+        client -> operation = e_encode;
+    }
+    else if(strcmp(argv[3], "-d") == 0)
+    {
+        client -> operation = e_decode;
+    }
+    else if(strcmp(argv[3], "-s") == 0)
+    {
+        client -> operation = e_unsupported;
+    }
+    else
+    {
+        return e_failure;
+    }
+
+    /* Shift so the args line up with argv of the -e/-d validation */
+    client -> args = &argv[2];
+
+    /* No failure return e_success */
+    return e_success;
+}
+
+/* Connect to the daemon, -2 when its backlog is full */
+static int client_connect(const char *socket_path)
+{
+    struct sockaddr_un addr;
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if(sock < 0)
+    {
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof (addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path);
+
+    if(connect(sock, (struct sockaddr *) &addr, sizeof (addr)) != 0)
+    {
+        /* A full listen backlog is the daemon being busy too */
+        if(errno == EAGAIN)
+        {
+            close(sock);
+            return -2;
+        }
+        perror("connect");
+        fprintf(stderr, "ERROR: Unable to connect to %s\n", socket_path);
+        close(sock);
+        return -1;
+    }
+
+    return sock;
+}
+
+/* Send a request, retrying with a growing delay while the daemon is busy */
+static Status client_request(ClientInfo *client, const char *msg, const int *fds, int nfds, char *reply, uint size)
+{
+    int delay_ms = STEGOD_RETRY_DELAY_MS;
+    int reply_fds[STEGOD_MAX_FDS];
+    int nreply;
+
+    for(int i = 0; i < STEGOD_RETRIES; i++)
+    {
+        int sock = client_connect(client -> socket_path);
+        Status ret;
+
+        if(sock == -1)
+        {
+            return e_failure;
+        }
+
+        if(sock >= 0)
+        {
+            /* A busy daemon may reply and hang up before the request is sent, so the reply is read regardless */
+            stegod_send(sock, msg, fds, nfds);
+            ret = stegod_recv(sock, reply, size, reply_fds, &nreply);
+            close(sock);
+
+            if(ret == e_failure || strcmp(reply, STEGOD_REPLY_BUSY) != 0)
+            {
+                return ret;
+            }
+        }
+
+        printf("stegod is busy, retrying in %d ms\n", delay_ms);
+        usleep(delay_ms * 1000);
+        delay_ms *= 2;
+    }
+
+    return e_failure;
+}
+
+/* Fields for the embedding options of a request, each with its leading tab */
+static Status client_options(const ClientInfo *client, char *opts, uint size)
+{
+    uint len = 0;
+
+    opts[0] = '\0';
+    if(client -> operation == e_encode && client -> adaptive)
+    {
+        len += snprintf(opts + len, size - len, "\t--adaptive");
+    }
+    if(client -> operation == e_encode && client -> hamming_k != 0)
+    {
+        len += snprintf(opts + len, size - len, "\t--hamming=%u", client -> hamming_k);
+    }
+    if(client -> key_phrase != NULL)
+    {
+        /* Fields are tab separated and the request ends at a newline */
+        if(strpbrk(client -> key_phrase, "\t\n") != NULL)
+        {
+            fprintf(stderr, "ERROR: stegod key phrases can not hold tabs or newlines\n");
+            return e_failure;
+        }
+        len += snprintf(opts + len, size - len, "\t--key=%s", client -> key_phrase);
+    }
+
+    return len < size ? e_success : e_failure;
+}
+
+/* Create the output under a temporary name next to it, renamed once the daemon succeeds */
+static int client_open_output(const char *fname, char *tmp_fname, uint size)
+{
+    mode_t mask = umask(0);
+    int fd;
+
+    umask(mask);
+    if((uint) snprintf(tmp_fname, size, "%s.XXXXXX", fname) >= size)
+    {
+        return -1;
+    }
+
+    fd = mkostemp(tmp_fname, O_CLOEXEC);
+    if(fd >= 0)
+    {
+        fchmod(fd, 0644 & ~mask);
+    }
+
+    return fd;
+}
+
+/*
+ * Function definition for the client.
+ * The client opens the files itself and passes the descriptors,
+ * so the daemon needs no access to the caller's paths.
+ */
+Status do_client(ClientInfo *client)
+{
+    char msg[STEGOD_MSG_SIZE];
+    char reply[STEGOD_MSG_SIZE];
+    const char *fnames[STEGOD_MAX_FDS];
+    char tmp_fname[STEGOD_MSG_SIZE];
+    char opts[STEGOD_MSG_SIZE];
+    const char *out_fname = NULL;
+    int fds[STEGOD_MAX_FDS];
+    int nfds = 0;
+    int len;
+    Status ret;
+
+    if(client_options(client, opts, sizeof (opts)) == e_failure)
+    {
+        return e_failure;
+    }
+
+    if(client -> operation == e_encode)
+    {
+        EncodeInfo encInfo;
+
+        memset(&encInfo, 0, sizeof (encInfo));
+        if(read_and_validate_encode_args(client -> args, &encInfo) == e_failure)
+        {
+            return e_failure;
+        }
+
+        fnames[nfds] = encInfo.src_image_fname;
+        fds[nfds++] = open(encInfo.src_image_fname, O_RDONLY | O_CLOEXEC);
+        fnames[nfds] = encInfo.secret_fname;
+        fds[nfds++] = open(encInfo.secret_fname, O_RDONLY | O_CLOEXEC);
+        fnames[nfds] = out_fname = encInfo.stego_image_fname;
+        fds[nfds++] = client_open_output(out_fname, tmp_fname, sizeof (tmp_fname));
+        len = snprintf(msg, sizeof (msg), "%s\t%s\t%s\t%s%s\n", STEGOD_REQ_ENCODE, encInfo.src_image_fname, encInfo.secret_fname, encInfo.stego_image_fname, opts);
+    }
+    else if(client -> operation == e_decode)
+    {
+        DecodeInfo decInfo;
+
+        memset(&decInfo, 0, sizeof (decInfo));
+        if(read_and_validate_decode_args(client -> args, &decInfo) == e_failure)
+        {
+            return e_failure;
+        }
+
+        fnames[nfds] = decInfo.stego_image_fname;
+        fds[nfds++] = open(decInfo.stego_image_fname, O_RDONLY | O_CLOEXEC);
+        fnames[nfds] = out_fname = decInfo.decode_fname;
+        fds[nfds++] = client_open_output(out_fname, tmp_fname, sizeof (tmp_fname));
+        len = snprintf(msg, sizeof (msg), "%s\t%s\t%s%s\n", STEGOD_REQ_DECODE, decInfo.stego_image_fname, decInfo.decode_fname, opts);
+    }
+    else
+    {
+        len = snprintf(msg, sizeof (msg), "%s\n", STEGOD_REQ_STATS);
+    }
+
+    /* Do Error handling, a cut request would lose its options */
+    ret = e_success;
+    if(len < 0 || len >= (int) sizeof (msg))
+    {
+        fprintf(stderr, "ERROR: The request does not fit in %d bytes\n", STEGOD_MSG_SIZE);
+        ret = e_failure;
+    }
+    for(int i = 0; i < nfds; i++)
+    {
+        if(fds[i] < 0)
+        {
+            perror("open");
+            fprintf(stderr, "ERROR: Unable to open file %s\n", fnames[i]);
+            ret = e_failure;
+        }
+    }
+
+    if(ret == e_success)
+    {
+        ret = client_request(client, msg, fds, nfds, reply, sizeof (reply));
+    }
+    if(ret == e_success)
+    {
+        printf("stegod: %s\n", reply);
+        ret = strncmp(reply, "OK", 2) == 0 ? e_success : e_failure;
+    }
+
+    for(int i = 0; i < nfds; i++)
+    {
+        if(fds[i] >= 0)
+        {
+            close(fds[i]);
+        }
+    }
+
+    /* A failed job leaves no output behind, an existing file is only replaced on success */
+    if(out_fname != NULL && fds[nfds - 1] >= 0)
+    {
+        if(ret == e_success && rename(tmp_fname, out_fname) != 0)
+        {
+            perror("rename");
+            fprintf(stderr, "ERROR: Unable to create file %s\n", out_fname);
+            ret = e_failure;
+        }
+        if(ret == e_failure)
+        {
+            unlink(tmp_fname);
+        }
+    }
+
+    return ret;
+}
@@ -2,43 +2,163 @@
 Name          : Muneer Mohammad Ali
 Date          : 09/05/2022
 Description   : LSB Steganography project
-Sample Input  : Encoding : ./a.out -e beautiful.bmp secret.txt stego.bmp
-				Decoding : ./a.out -d stego.bmp decode.txt
+Sample Input  : Encoding : ./stego -e beautiful.bmp secret.txt stego.bmp
+				Decoding : ./stego -d stego.bmp decode.txt
+				Archive  : ./stego -e beautiful.bmp stego.bmp --archive a.conf b.conf
+				           ./stego -d stego.bmp --list
+				           ./stego -d stego.bmp --extract=a.conf
+				Planning : ./stego -p secret.txt beautiful.bmp
+				           ./stego -p beautiful.bmp --archive a.conf b.conf
+				Analysis : ./stego -a stego.bmp beautiful.bmp
 Sample Output : Encoding : stego.bmp
 				Decoding : decode.txt
 ******************************************/
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "common.h"
 #include "encode.h"
 #include "decode.h"
+#include "plan.h"
 #include "types.h"
+#include "io_engine.h"
+#include "stegod.h"
+#include "analyze.h"
+#include "metrics.h"
+#include "hamming.h"
+
+/* Options given with -- anywhere on the command line */
+typedef struct _Options
+{
+    IoBackend io_backend;       // --io=sync|uring
+    int want_metrics;           // --metrics
+    int adaptive;               // --adaptive
+    const char *key_phrase;     // --key=phrase
+    uint hamming_k;             // --hamming=k
+    int archive;                // --archive, several files after the stego image
+    int archive_pos;            // Positional arg following --archive
+    int list_archive;           // --list
+    const char *extract_name;   // --extract=name
+
+} Options;
+
+/* Pick the -- options out of argv, leaving the positional args in place */
+static Status read_options(char *argv[], Options *options)
+{
+    int j = 1;
+
+    memset(options, 0, sizeof (Options));
+    options->io_backend = e_io_sync;
+    for(int i = 1; argv[i] != NULL; i++)
+    {
+        if(strcmp(argv[i], "--metrics") == 0)
+        {
+            options->want_metrics = 1;
+        }
+        else if(strcmp(argv[i], "--adaptive") == 0)
+        {
+            options->adaptive = 1;
+        }
+        else if(strcmp(argv[i], "--archive") == 0)
+        {
+            options->archive = 1;
+            options->archive_pos = j;
+        }
+        else if(strcmp(argv[i], "--list") == 0)
+        {
+            options->list_archive = 1;
+        }
+        else if(strncmp(argv[i], "--extract=", 10) == 0)
+        {
+            options->extract_name = argv[i] + 10;
+        }
+        else if(strncmp(argv[i], "--key=", 6) == 0)
+        {
+            options->key_phrase = argv[i] + 6;
+        }
+        else if(strncmp(argv[i], "--hamming=", 10) == 0)
+        {
+            options->hamming_k = atoi(argv[i] + 10);
+            if(options->hamming_k < HAMMING_MIN_K || options->hamming_k > HAMMING_MAX_K)
+            {
+                printf("Hamming code k must be %d to %d\n", HAMMING_MIN_K, HAMMING_MAX_K);
+                return e_failure;
+            }
+        }
+        else if(strncmp(argv[i], "--io=", 5) != 0)
+        {
+            /* A mistyped option would otherwise be taken for a file name */
+            if(strncmp(argv[i], "--", 2) == 0)
+            {
+                printf("Unknown option %s\n", argv[i]);
+                return e_failure;
+            }
+            argv[j++] = argv[i];
+        }
+        else if(strcmp(argv[i] + 5, "uring") == 0)
+        {
+            options->io_backend = e_io_uring;
+        }
+        else if(strcmp(argv[i] + 5, "sync") != 0)
+        {
+            printf("Unknown I/O backend %s\n", argv[i] + 5);
+            return e_failure;
+        }
+    }
+    argv[j] = NULL;
+
+    return e_success;
+}
 
 int main(int argc, char *argv[])
 {
-	/* Unsigned int variable to store the image size*/ 
-    uint img_size;
+	/* I/O backend, metrics and embedding options */
+    Options options;
+
+    /* Set by the operation once it succeeds, scripts get a non-zero exit otherwise */
+    Status ret = e_failure;
+
+    if(read_options(argv, &options) == e_failure)
+    {
+        return 1;
+    }
 
     /* Check the operation type is encoding (-e) */
     if(check_operation_type(argv) == e_encode)
     {
 		/* Struct variable to store encoding related info */
         EncodeInfo encInfo;
+        StegoMetrics metrics;
+        MetricsReport report;
+        memset(&encInfo, 0, sizeof (encInfo));
+        encInfo.io_backend = options.io_backend;
+        encInfo.metrics = options.want_metrics ? &metrics : NULL;
+        encInfo.adaptive = options.adaptive;
+        encInfo.key_phrase = options.key_phrase;
+        encInfo.hamming_k = options.hamming_k;
         
         printf("----------Selected Encoding----------\n");
 
-        /* Read and validate CLA */
-        if(read_and_validate_encode_args(argv, &encInfo) == e_success)
+        /* Read and validate CLA, an archive takes the stego image and then its members */
+        if((options.archive ? read_and_validate_archive_args(argv, &encInfo) : read_and_validate_encode_args(argv, &encInfo)) == e_success)
         {
             printf("Reading and validating inputs is successful\n");
             if(do_encoding(&encInfo) == e_success)
             {
+                ret = e_success;
                 printf("Encoding is completed\n");
+                if(encInfo.metrics != NULL)
+                {
+                    metrics_report(encInfo.metrics, &report);
+                    printf("stego=%s cover=%s ", encInfo.stego_image_fname, encInfo.src_image_fname);
+                    metrics_print("metrics:", &report, 1);
+                }
             }
             else
             {
                 printf("Encoding failed!!!\n");
             }
+            close_files(&encInfo);
         }
         else
         {
@@ -51,6 +171,11 @@ int main(int argc, char *argv[])
     {
 		/* Struct variable to store decoding related info */
         DecodeInfo decInfo;
+        memset(&decInfo, 0, sizeof (decInfo));
+        decInfo.io_backend = options.io_backend;
+        decInfo.key_phrase = options.key_phrase;
+        decInfo.list_archive = options.list_archive;
+        decInfo.extract_name = options.extract_name;
         
         printf("----------Selected Decoding----------\n");
 
@@ -60,12 +185,109 @@ int main(int argc, char *argv[])
             printf("Reading and validating inputs is successful\n");
             if(do_decoding(&decInfo) == e_success)
             {
+                ret = e_success;
                 printf("Decoding is completed\n");
             }
             else
             {
                 printf("Decoding failed!!!\n");
             }
+            close_decode_files(&decInfo);
+        }
+        else
+        {
+            printf("Reading and validating inputs failed!!!\n");
+        }
+    }
+
+    /* Check the operation type is Planning (-p) */
+    else if(check_operation_type(argv) == e_plan)
+    {
+		/* Struct variable to store planning related info */
+        PlanInfo planInfo;
+        memset(&planInfo, 0, sizeof (planInfo));
+        planInfo.adaptive = options.adaptive;
+        planInfo.hamming_k = options.hamming_k;
+
+        printf("----------Selected Planning----------\n");
+
+        /* Read and validate CLA, an archive lists its covers before --archive and the members after it */
+        if((options.archive ? read_and_validate_plan_archive_args(argv, options.archive_pos, &planInfo) :
+                              read_and_validate_plan_args(argv, &planInfo)) == e_success)
+        {
+            ret = do_planning(&planInfo);
+        }
+        else
+        {
+            printf("Reading and validating inputs failed!!!\n");
+        }
+        close_plan(&planInfo);
+    }
+
+    /* Check the operation type is Daemon (-D) */
+    else if(check_operation_type(argv) == e_daemon)
+    {
+		/* Struct variable to store daemon state */
+        static StegodInfo stegod;
+
+        stegod.io_backend = options.io_backend;
+        if(read_and_validate_daemon_args(argv, &stegod) == e_success)
+        {
+            ret = do_daemon(&stegod);
+        }
+        else
+        {
+            printf("Reading and validating inputs failed!!!\n");
+        }
+    }
+
+    /* Check the operation type is Client (-c) */
+    else if(check_operation_type(argv) == e_client)
+    {
+		/* Struct variable to store the request */
+        ClientInfo client;
+
+        memset(&client, 0, sizeof (client));
+        client.adaptive = options.adaptive;
+        client.key_phrase = options.key_phrase;
+        client.hamming_k = options.hamming_k;
+
+        /* Options the daemon can not carry out are refused rather than dropped */
+        if(options.want_metrics || options.archive || options.list_archive || options.extract_name != NULL)
+        {
+            fprintf(stderr, "ERROR: --metrics, --archive, --list and --extract are not supported with -c\n");
+            printf("Request failed!!!\n");
+        }
+        else if(read_and_validate_client_args(argv, &client) == e_success)
+        {
+            if(do_client(&client) == e_success)
+            {
+                ret = e_success;
+                printf("Request is completed\n");
+            }
+            else
+            {
+                printf("Request failed!!!\n");
+            }
+        }
+        else
+        {
+            printf("Reading and validating inputs failed!!!\n");
+        }
+    }
+
+    /* Check the operation type is Analysis (-a) */
+    else if(check_operation_type(argv) == e_analyze)
+    {
+		/* Struct variable to store analysis related info */
+        AnalyzeInfo anaInfo;
+
+        printf("----------Selected Analysis----------\n");
+
+        /* Read and validate CLA */
+        if(read_and_validate_analyze_args(argv, &anaInfo) == e_success)
+        {
+            ret = do_analysis(&anaInfo);
         }
         else
         {
@@ -77,18 +299,30 @@ int main(int argc, char *argv[])
     else
     {
         printf("Invalid Option\n");
-        printf("Encoding : ./a.out -e beautiful.bmp secret.txt stego.bmp\n");
-        printf("Decoding : ./a.out -d stego.bmp decode.txt\n");
+        printf("Encoding : ./stego -e beautiful.bmp secret.txt stego.bmp\n");
+        printf("Decoding : ./stego -d stego.bmp decode.txt\n");
+        printf("Planning : ./stego -p secret.txt cover1.bmp [cover2.png ...] or -p cover1.bmp [...] --archive a.conf b.conf\n");
+        printf("Analysis : ./stego -a image1.bmp [image2.png ...]\n");
+        printf("Daemon   : ./stego -D /tmp/stegod.sock\n");
+        printf("Client   : ./stego -c /tmp/stegod.sock -e|-d ... or -s for stats\n");
+        printf("Options  : --io=sync|uring, --metrics, --adaptive, --key=phrase, --hamming=k, --archive, --list, --extract=name\n");
+        printf("Archives : ./stego -e beautiful.bmp stego.bmp --archive a.conf b.conf, -d stego.bmp --list or --extract=name [out]\n");
+        printf("Cover images : .bmp, .ppm/.pgm/.pnm, .tga, .png\n");
     }
         
-    return 0;
+    return ret == e_success ? 0 : 1;
 }
 
 /* String compare and check if operation is -e or -d */
 OperationType check_operation_type(char *argv[])
 {
+	/* No operation given */
+    if(argv[1] == NULL)
+    {
+        return e_unsupported;
+    }
 	/* String compare for -e */
-    if(strcmp(argv[1],"-e") == 0)
+    else if(strcmp(argv[1],"-e") == 0)
     {
         return e_encode;
     }
@@ -96,6 +330,26 @@ OperationType check_operation_type(char *argv[])
     else if(strcmp(argv[1],"-d") == 0)
     {
         return e_decode;
+    }
+	/* String compare for -p */
+    else if(strcmp(argv[1],"-p") == 0)
+    {
+        return e_plan;
+    }
+	/* String compare for -D */
+    else if(strcmp(argv[1],"-D") == 0)
+    {
+        return e_daemon;
+    }
+	/* String compare for -c */
+    else if(strcmp(argv[1],"-c") == 0)
+    {
+        return e_client;
+    }
+	/* String compare for -a */
+    else if(strcmp(argv[1],"-a") == 0)
+    {
+        return e_analyze;
     }
 	/* String compare not matching -e or -d failure */
     else
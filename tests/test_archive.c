@@ -0,0 +1,237 @@
+/* This file contains the archive test: random members are embedded together, listed and extracted one by one */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "test_support.h"
+#include "../archive.h"
+#include "../plan.h"
+
+#define ARCHIVE_CASES 60
+#define ARCHIVE_MAX_MEMBERS 12
+#define ARCHIVE_PARAM_BYTES 2
+
+/* Cover formats with their channel counts */
+static const struct
+{
+    const char *format;
+    uint channels;
+} archive_formats[] =
+{
+    { "bmp", 3 }, { "ppm", 3 }, { "pgm", 1 }, { "tga", 4 }, { "png", 3 },
+};
+
+/* Extract through a random path, sync, io_uring or a memory stream */
+static void archive_pick_path(TestRand *rand, TestJob *job)
+{
+    uint path = test_rand_range(rand, 0, 2);
+
+    job->io_backend = path == 1 ? e_io_uring : e_io_sync;
+    job->in_memory = path == 2;
+}
+
+/* Whether -p says the archive fits the cover */
+static int archive_plan_fits(const char *cover_fname, char **fnames)
+{
+    PlanInfo planInfo;
+    CapacityPlan plan;
+    int fits = 0;
+
+    memset(&planInfo, 0, sizeof (planInfo));
+    planInfo.archive_fnames = fnames;
+    if(archive_build(&planInfo.archive, fnames) == e_success)
+    {
+        planInfo.size_secret_file = planInfo.archive.index_size + planInfo.archive.data_size;
+        fits = plan_cover_capacity(cover_fname, &planInfo, &plan) == e_success && plan.fits;
+    }
+    close_plan(&planInfo);
+
+    return fits;
+}
+
+/* Run one random case */
+static void archive_case(TestRand *rand, const char *dir, uint case_no)
+{
+    static char member_fnames[ARCHIVE_MAX_MEMBERS][TEST_PATH_SIZE];
+    char *fnames[ARCHIVE_MAX_MEMBERS + 1];
+    char cover_fname[TEST_PATH_SIZE], stego_fname[TEST_PATH_SIZE], decode_fname[TEST_PATH_SIZE];
+    char base[32];
+    uint f = test_rand_range(rand, 0, sizeof (archive_formats) / sizeof (archive_formats[0]) - 1);
+    TestCover cover = { archive_formats[f].format, 0, 0, archive_formats[f].channels, 0 };
+    uint count = test_rand_range(rand, 1, ARCHIVE_MAX_MEMBERS);
+    uint index_size = ARCHIVE_COUNT_BYTES, capacity, room;
+    TestJob job;
+
+    cover.width = test_rand_range(rand, 60, 240);
+    cover.height = test_rand_range(rand, 60, 160);
+    cover.seed = test_rand(rand);
+
+    snprintf(base, sizeof (base), "cover%s", test_cover_extn(&cover));
+    test_path(cover_fname, dir, base);
+    snprintf(base, sizeof (base), "stego%s", test_cover_extn(&cover));
+    test_path(stego_fname, dir, base);
+    test_path(decode_fname, dir, "member.out");
+    remove(stego_fname);
+
+    if(test_make_cover(cover_fname, &cover) == e_failure)
+    {
+        TEST_CHECK(0, "case %u: cover not written", case_no);
+        return;
+    }
+
+    /* Members share what the index leaves of the capacity */
+    for(uint i = 0; i < count; i++)
+    {
+        snprintf(base, sizeof (base), "m%u.bin", i);
+        test_path(member_fnames[i], dir, base);
+        fnames[i] = member_fnames[i];
+        index_size += ARCHIVE_ENTRY_FIXED_BYTES + strlen(base);
+    }
+    fnames[count] = NULL;
+    capacity = test_capacity(cover_fname, 0) - ARCHIVE_PARAM_BYTES;
+    room = capacity > index_size ? capacity - index_size : 0;
+    for(uint i = 0; i < count; i++)
+    {
+        uint size = test_rand_range(rand, 0, room / (count - i));
+
+        test_make_secret(fnames[i], size, cover.seed + i);
+        room -= size;
+    }
+
+    #define CASE_FMT "case %u %s %ux%u members=%u: "
+    #define CASE_ARGS case_no, cover.format, cover.width, cover.height, count
+
+    memset(&job, 0, sizeof (job));
+    job.cover_fname = cover_fname;
+    job.stego_fname = stego_fname;
+    job.decode_fname = decode_fname;
+    job.archive_fnames = fnames;
+    if(test_encode(&job) == e_failure)
+    {
+        TEST_CHECK(0, CASE_FMT "encoding failed", CASE_ARGS);
+        return;
+    }
+    TEST_CHECK(archive_plan_fits(cover_fname, fnames), CASE_FMT "planner refuses an accepted archive", CASE_ARGS);
+
+    /* An archive is only read through the list or one member */
+    TEST_CHECK(test_decode(&job) == e_failure, CASE_FMT "decoded without --list or --extract", CASE_ARGS);
+    remove(decode_fname);
+    job.list_archive = 1;
+    TEST_CHECK(test_decode(&job) == e_success, CASE_FMT "listing failed", CASE_ARGS);
+    job.list_archive = 0;
+    TEST_CHECK(access(decode_fname, F_OK) != 0, CASE_FMT "listing wrote a file", CASE_ARGS);
+
+    for(uint i = 0; i < count; i++)
+    {
+        const char *name = strrchr(fnames[i], '/') + 1;
+
+        remove(decode_fname);
+        archive_pick_path(rand, &job);
+        job.extract_name = name;
+        TEST_CHECK(test_decode(&job) == e_success && test_same_file(fnames[i], decode_fname),
+                   CASE_FMT "member %s io=%d memory=%d does not round trip", CASE_ARGS, name, job.io_backend, job.in_memory);
+    }
+
+    /* A missing member fails before the output file is created */
+    remove(decode_fname);
+    job.extract_name = "missing.bin";
+    TEST_CHECK(test_decode(&job) == e_failure, CASE_FMT "missing member extracted", CASE_ARGS);
+    TEST_CHECK(access(decode_fname, F_OK) != 0, CASE_FMT "missing member left a file", CASE_ARGS);
+
+    /* One byte past the capacity is refused */
+    job.in_memory = 0;
+    job.extract_name = NULL;
+    remove(stego_fname);
+    test_make_secret(fnames[0], capacity - index_size + 1, cover.seed);
+    TEST_CHECK(test_encode(&job) == e_failure, CASE_FMT "archive past the capacity was accepted", CASE_ARGS);
+    TEST_CHECK(!archive_plan_fits(cover_fname, fnames), CASE_FMT "planner fits an archive past the capacity", CASE_ARGS);
+
+    #undef CASE_FMT
+    #undef CASE_ARGS
+}
+
+/* Archives that can not be built or read */
+static void archive_misuse(const char *dir)
+{
+    char cover_fname[TEST_PATH_SIZE], stego_fname[TEST_PATH_SIZE], secret_fname[TEST_PATH_SIZE];
+    char decode_fname[TEST_PATH_SIZE], sub_dir[TEST_PATH_SIZE], other_fname[TEST_PATH_SIZE];
+    char *fnames[3] = { secret_fname, other_fname, NULL };
+    TestCover cover = { "bmp", 120, 80, 3, 7 };
+    TestJob job;
+
+    test_make_cover(test_path(cover_fname, dir, "misuse.bmp"), &cover);
+    test_path(stego_fname, dir, "misuse-stego.bmp");
+    test_path(decode_fname, dir, "misuse.out");
+    test_make_secret(test_path(secret_fname, dir, "same.bin"), 100, 1);
+    test_path(sub_dir, dir, "sub");
+    mkdir(sub_dir, 0700);
+    test_make_secret(test_path(other_fname, sub_dir, "same.bin"), 100, 2);
+
+    memset(&job, 0, sizeof (job));
+    job.cover_fname = cover_fname;
+    job.stego_fname = stego_fname;
+    job.decode_fname = decode_fname;
+
+    /* Members are named by their base names, which must be unique */
+    job.archive_fnames = fnames;
+    TEST_CHECK(test_encode(&job) == e_failure, "members with the same name were accepted");
+    unlink(other_fname);
+    rmdir(sub_dir);
+
+    /* Archives use the plain layout only */
+    fnames[1] = NULL;
+    job.hamming_k = 3;
+    TEST_CHECK(test_encode(&job) == e_failure, "archive with Hamming codes was accepted");
+    job.hamming_k = 0;
+    job.adaptive = 1;
+    job.key_phrase = "misuse";
+    TEST_CHECK(test_encode(&job) == e_failure, "adaptive archive was accepted");
+
+    /* A plain stego image holds no archive */
+    memset(&job, 0, sizeof (job));
+    job.cover_fname = cover_fname;
+    job.secret_fname = secret_fname;
+    job.stego_fname = stego_fname;
+    job.decode_fname = decode_fname;
+    remove(stego_fname);
+    TEST_CHECK(test_encode(&job) == e_success, "plain encoding failed");
+    job.list_archive = 1;
+    TEST_CHECK(test_decode(&job) == e_failure, "plain stego image was listed as an archive");
+    job.list_archive = 0;
+    job.extract_name = "same.bin";
+    TEST_CHECK(test_decode(&job) == e_failure, "member extracted from a plain stego image");
+}
+
+/*
+ * Usage: test_archive [cases] [seed]
+ * Random members are embedded as one archive, the archive is listed
+ * and every member is extracted on its own through a random I/O path
+ * and compared with its file.
+ */
+int main(int argc, char *argv[])
+{
+    uint cases = argc > 1 ? strtoul(argv[1], NULL, 0) : ARCHIVE_CASES;
+    unsigned long long seed = argc > 2 ? strtoull(argv[2], NULL, 0) : 0xA4C;
+    char dir[TEST_PATH_SIZE];
+    TestRand rand;
+
+    if(test_temp_dir(dir, sizeof (dir)) == e_failure)
+    {
+        perror("mkdtemp");
+        return 2;
+    }
+
+    test_rand_seed(&rand, seed);
+    for(uint i = 0; i < cases; i++)
+    {
+        archive_case(&rand, dir, i);
+    }
+    archive_misuse(dir);
+    test_remove_dir(dir);
+
+    printf("cases=%u seed=%#llx failures=%d\n", cases, seed, test_failures);
+
+    return test_failures ? 1 : 0;
+}
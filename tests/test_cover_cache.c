@@ -0,0 +1,279 @@
+/* This file contains the cover cache test: file hits, content deduplication, cached headers and eviction */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "test_support.h"
+#include "../cover_cache.h"
+
+#define CACHE_THREADS 4
+#define CACHE_THREAD_ROUNDS 300
+#define CACHE_COVERS 3
+
+/* Get a file through the cache */
+static CoverCacheEntry *cache_get_fname(CoverCache *cache, const char *fname)
+{
+    int fd = open(fname, O_RDONLY);
+    CoverCacheEntry *entry;
+
+    if(fd < 0)
+    {
+        return NULL;
+    }
+    entry = cover_cache_get(cache, fd);
+    close(fd);
+
+    return entry;
+}
+
+/* Check an entry holds the bytes of a file */
+static int cache_holds(const CoverCacheEntry *entry, const char *fname)
+{
+    long size;
+    unsigned char *data = test_read_file(fname, &size);
+    int ok = entry != NULL && data != NULL && entry->size == size && memcmp(entry->data, data, size) == 0;
+
+    free(data);
+
+    return ok;
+}
+
+/* Give a file a new mtime, so the cache sees it changed even within one clock tick */
+static void cache_touch(const char *fname, time_t sec)
+{
+    struct timespec times[2] = { { sec, 0 }, { sec, 0 } };
+
+    utimensat(AT_FDCWD, fname, times, 0);
+}
+
+/* Same file, a copy of it, a changed file and a file changed back */
+static void cache_identity_run(const char *dir)
+{
+    char a_fname[TEST_PATH_SIZE], b_fname[TEST_PATH_SIZE];
+    TestCover cover = { "bmp", 64, 48, 3, 1 };
+    TestCover other = { "bmp", 64, 48, 3, 2 };
+    CoverCacheEntry *a, *b;
+    CoverCache cache;
+
+    test_make_cover(test_path(a_fname, dir, "a.bmp"), &cover);
+    test_make_cover(test_path(b_fname, dir, "b.bmp"), &cover);
+    cover_cache_init(&cache, 1 << 20);
+
+    a = cache_get_fname(&cache, a_fname);
+    TEST_CHECK(cache_holds(a, a_fname) && cache.misses == 1, "first get is not a miss");
+    cover_cache_put(&cache, a);
+
+    a = cache_get_fname(&cache, a_fname);
+    TEST_CHECK(cache.hits == 1 && cache.misses == 1, "second get of the same file is not a hit");
+
+    /* A copy is read once, then shares the entry */
+    b = cache_get_fname(&cache, b_fname);
+    TEST_CHECK(b == a && cache.dedups == 1 && cache.entries == 1 && cache.bytes == (size_t) a->size,
+               "copy of a cached cover is stored twice");
+    cover_cache_put(&cache, b);
+    b = cache_get_fname(&cache, b_fname);
+    TEST_CHECK(b == a && cache.hits == 2, "copy is not a hit once known");
+    cover_cache_put(&cache, a);
+    cover_cache_put(&cache, b);
+
+    /* Changed content gets its own entry, the copy keeps the old one */
+    test_make_cover(a_fname, &other);
+    cache_touch(a_fname, 1000);
+    a = cache_get_fname(&cache, a_fname);
+    TEST_CHECK(a != b && cache_holds(a, a_fname) && cache.misses == 2 && cache.entries == 2, "changed file is not read again");
+    cover_cache_put(&cache, a);
+    b = cache_get_fname(&cache, b_fname);
+    TEST_CHECK(cache_holds(b, b_fname) && cache.hits == 3, "copy lost its entry when the file changed");
+    cover_cache_put(&cache, b);
+
+    /* Changed back, the old content is found again */
+    test_make_cover(a_fname, &cover);
+    cache_touch(a_fname, 2000);
+    a = cache_get_fname(&cache, a_fname);
+    TEST_CHECK(a == b && cache.dedups == 2 && cache.misses == 2, "file changed back is not deduplicated");
+    cover_cache_put(&cache, a);
+
+    printf("identity hits=%lu dedups=%lu misses=%lu\n", cache.hits, cache.dedups, cache.misses);
+    cover_cache_destroy(&cache);
+}
+
+/* Headers are parsed once per entry, and encode as a parsed cover */
+static void cache_header_run(const char *dir)
+{
+    char cover_fname[TEST_PATH_SIZE], secret_fname[TEST_PATH_SIZE];
+    char plain_fname[TEST_PATH_SIZE], cached_fname[TEST_PATH_SIZE], decode_fname[TEST_PATH_SIZE];
+    TestCover cover = { "bmp", 96, 61, 3, 3 };
+    const CoverInfo *header;
+    CoverCacheEntry *entry;
+    CoverCache cache;
+    TestJob job;
+
+    test_make_cover(test_path(cover_fname, dir, "header.bmp"), &cover);
+    test_make_secret(test_path(secret_fname, dir, "header.txt"), 500, 3);
+    cover_cache_init(&cache, 1 << 20);
+
+    entry = cache_get_fname(&cache, cover_fname);
+    header = entry != NULL ? cover_cache_header(&cache, entry, &bmp_format) : NULL;
+    TEST_CHECK(header != NULL && header->width == cover.width && header->height == cover.height &&
+               header->pixel_span == cover.width * cover.height * cover.channels, "cached header does not match the cover");
+    TEST_CHECK(entry == NULL || cover_cache_header(&cache, entry, &bmp_format) == header, "header parsed twice");
+    TEST_CHECK(entry == NULL || cover_cache_header(&cache, entry, &ppm_format) == NULL, "bmp cover has a ppm header");
+
+    /* The encoder takes the cached header instead of parsing */
+    memset(&job, 0, sizeof (job));
+    job.cover_fname = cover_fname;
+    job.secret_fname = secret_fname;
+    job.decode_fname = test_path(decode_fname, dir, "header.out");
+    job.stego_fname = test_path(plain_fname, dir, "plain.bmp");
+    TEST_CHECK(test_encode(&job) == e_success, "plain encoding failed");
+    job.stego_fname = test_path(cached_fname, dir, "cached.bmp");
+    job.in_memory = 1;
+    job.cover_header = header;
+    TEST_CHECK(test_encode(&job) == e_success && test_same_file(plain_fname, cached_fname),
+               "encoding with the cached header differs");
+    TEST_CHECK(test_decode(&job) == e_success && test_same_file(secret_fname, decode_fname), "cached header stego does not decode");
+
+    if(entry != NULL)
+    {
+        cover_cache_put(&cache, entry);
+    }
+    cover_cache_destroy(&cache);
+}
+
+/* Least recently used covers go first, entries in use stay readable */
+static void cache_evict_run(const char *dir)
+{
+    char fnames[CACHE_COVERS][TEST_PATH_SIZE];
+    CoverCacheEntry *entries[CACHE_COVERS];
+    CoverCache cache;
+    char base[32];
+    long size = 0;
+
+    for(uint i = 0; i < CACHE_COVERS; i++)
+    {
+        TestCover cover = { "bmp", 64, 48, 3, 10 + i };
+
+        snprintf(base, sizeof (base), "evict%u.bmp", i);
+        test_make_cover(test_path(fnames[i], dir, base), &cover);
+    }
+    free(test_read_file(fnames[0], &size));
+
+    /* Room for two covers */
+    cover_cache_init(&cache, size * 2 + size / 2);
+    entries[0] = cache_get_fname(&cache, fnames[0]);
+    entries[1] = cache_get_fname(&cache, fnames[1]);
+    cover_cache_put(&cache, entries[1]);
+    entries[2] = cache_get_fname(&cache, fnames[2]);
+    TEST_CHECK(cache.evictions == 1 && cache.entries == 2, "cache grew past its bound");
+    TEST_CHECK(cache_holds(entries[0], fnames[0]), "evicted entry in use was freed");
+    cover_cache_put(&cache, entries[0]);
+    cover_cache_put(&cache, entries[2]);
+
+    entries[2] = cache_get_fname(&cache, fnames[2]);
+    TEST_CHECK(cache.hits == 1, "recently used cover was evicted");
+    cover_cache_put(&cache, entries[2]);
+
+    cover_cache_destroy(&cache);
+}
+
+/* Worker of the threaded run */
+typedef struct
+{
+    CoverCache *cache;
+    char (*fnames)[TEST_PATH_SIZE];
+    uint fname_count;
+    uint seed;
+    int failures;
+} CacheThread;
+
+static void *cache_thread(void *arg)
+{
+    CacheThread *thread = arg;
+    TestRand rand;
+
+    test_rand_seed(&rand, thread->seed);
+    for(uint i = 0; i < CACHE_THREAD_ROUNDS; i++)
+    {
+        const char *fname = thread->fnames[test_rand_range(&rand, 0, thread->fname_count - 1)];
+        CoverCacheEntry *entry = cache_get_fname(thread->cache, fname);
+
+        if(!cache_holds(entry, fname) || cover_cache_header(thread->cache, entry, &bmp_format) == NULL)
+        {
+            thread->failures++;
+        }
+        if(entry != NULL)
+        {
+            cover_cache_put(thread->cache, entry);
+        }
+    }
+
+    return NULL;
+}
+
+/* Jobs sharing the cache, with copies and evictions going on */
+static void cache_threads_run(const char *dir)
+{
+    char fnames[CACHE_COVERS * 2][TEST_PATH_SIZE];
+    CacheThread threads[CACHE_THREADS];
+    pthread_t ids[CACHE_THREADS];
+    CoverCache cache;
+    char base[32];
+    long size = 0;
+
+    /* Every cover twice, under two names */
+    for(uint i = 0; i < CACHE_COVERS * 2; i++)
+    {
+        TestCover cover = { "bmp", 64, 48, 3, 20 + i / 2 };
+
+        snprintf(base, sizeof (base), "thread%u.bmp", i);
+        test_make_cover(test_path(fnames[i], dir, base), &cover);
+    }
+    free(test_read_file(fnames[0], &size));
+    cover_cache_init(&cache, size * 2);
+
+    for(uint i = 0; i < CACHE_THREADS; i++)
+    {
+        threads[i] = (CacheThread) { &cache, fnames, CACHE_COVERS * 2, i + 1, 0 };
+        pthread_create(&ids[i], NULL, cache_thread, &threads[i]);
+    }
+    for(uint i = 0; i < CACHE_THREADS; i++)
+    {
+        pthread_join(ids[i], NULL);
+        TEST_CHECK(threads[i].failures == 0, "thread %u got %d wrong covers", i, threads[i].failures);
+    }
+    TEST_CHECK(cache.entries <= 2 && cache.bytes <= cache.max_bytes, "cache grew past its bound");
+
+    printf("threads hits=%lu dedups=%lu misses=%lu evictions=%lu\n", cache.hits, cache.dedups, cache.misses, cache.evictions);
+    cover_cache_destroy(&cache);
+}
+
+/*
+ * Usage: test_cover_cache
+ * The stegod cover cache must hit known files without reading them,
+ * share the content of copies, parse a header once per entry, stay
+ * within its bound and hand every job the bytes of its file.
+ */
+int main(void)
+{
+    char dir[TEST_PATH_SIZE];
+
+    if(test_temp_dir(dir, sizeof (dir)) == e_failure)
+    {
+        perror("mkdtemp");
+        return 2;
+    }
+
+    cache_identity_run(dir);
+    cache_header_run(dir);
+    cache_evict_run(dir);
+    cache_threads_run(dir);
+    test_remove_dir(dir);
+
+    printf("failures=%d\n", test_failures);
+
+    return test_failures ? 1 : 0;
+}
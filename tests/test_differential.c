@@ -0,0 +1,290 @@
+/* This file contains the differential test: every implementation of a path must give the same bytes on random inputs */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "test_support.h"
+#include "../kernels.h"
+#include "../analyze.h"
+
+#define DIFF_KERNEL_ROUNDS 200
+#define DIFF_KERNEL_MAX_BYTES 4100
+#define DIFF_KERNEL_MAX_SHIFT 64
+#define DIFF_IMAGE_CASES 40
+#define DIFF_ANALYZE_IMAGES 24
+
+static const char *const diff_kernels[] = { "generic", "sse2", "avx2", "avx512", NULL };
+
+/* Ways to run the same encode or decode */
+typedef enum
+{
+    e_path_sync,                // stdio on files
+    e_path_uring,               // io_uring engine
+    e_path_pool,                // engine thread pool pread/pwrite
+    e_path_memory,              // images read from memory streams
+    e_path_count
+} DiffPath;
+
+static const char *const diff_path_names[] = { "sync", "uring", "pool", "memory" };
+
+/* Set up a job for a path, the pool is forced through STEGO_IO_POOL */
+static void diff_path_job(TestJob *job, DiffPath path)
+{
+    job->io_backend = path == e_path_uring || path == e_path_pool ? e_io_uring : e_io_sync;
+    job->in_memory = path == e_path_memory;
+
+    if(path == e_path_pool)
+        setenv("STEGO_IO_POOL", "1", 1);
+    else
+        unsetenv("STEGO_IO_POOL");
+}
+
+/* Every kernel against the generic one on random lengths and alignments */
+static void diff_kernels_run(TestRand *rand)
+{
+    size_t size = DIFF_KERNEL_MAX_BYTES * 8 + DIFF_KERNEL_MAX_SHIFT;
+    size_t payload_size = DIFF_KERNEL_MAX_BYTES + DIFF_KERNEL_MAX_SHIFT;
+    unsigned char *original = malloc(size);
+    unsigned char *reference = malloc(size);
+    unsigned char *channels = malloc(size);
+    unsigned char *payload = malloc(payload_size);
+    unsigned char *extracted = malloc(payload_size);
+    uint checked = 0;
+
+    if(original == NULL || reference == NULL || channels == NULL || payload == NULL || extracted == NULL)
+    {
+        TEST_CHECK(0, "kernel buffers not allocated");
+        free(original); free(reference); free(channels); free(payload); free(extracted);
+        return;
+    }
+
+    for(uint round = 0; round < DIFF_KERNEL_ROUNDS; round++)
+    {
+        /* Every short length, then random ones, at random alignments */
+        uint n = round < 64 ? round : test_rand_range(rand, 0, DIFF_KERNEL_MAX_BYTES);
+        uint channel_shift = test_rand_range(rand, 0, DIFF_KERNEL_MAX_SHIFT - 1);
+        uint payload_shift = test_rand_range(rand, 0, DIFF_KERNEL_MAX_SHIFT - 1);
+        const char *in = (const char *) payload + payload_shift;
+        char *out = (char *) extracted + payload_shift;
+
+        test_rand_fill(rand, original, size);
+        test_rand_fill(rand, payload, payload_size);
+        memcpy(reference, original, size);
+        lsb_kernels_generic.embed((char *) reference + channel_shift, in, n);
+
+        for(int k = 0; diff_kernels[k] != NULL; k++)
+        {
+            const LsbKernels *kernels = lsb_kernels_by_name(diff_kernels[k]);
+
+            if(kernels == NULL)
+            {
+                continue;
+            }
+
+            /* The bytes around the range must stay as they are */
+            memcpy(channels, original, size);
+            kernels->embed((char *) channels + channel_shift, in, n);
+            TEST_CHECK(memcmp(channels, reference, size) == 0, "kernel %s: embed of %u bytes at +%u differs from generic",
+                       kernels->name, n, channel_shift);
+
+            memset(extracted, 0xA5, payload_size);
+            kernels->extract(out, (const char *) reference + channel_shift, n);
+            TEST_CHECK(memcmp(out, in, n) == 0, "kernel %s: extract of %u bytes at +%u differs from the payload",
+                       kernels->name, n, channel_shift);
+            TEST_CHECK(n + payload_shift >= payload_size || (unsigned char) out[n] == 0xA5,
+                       "kernel %s: extract of %u bytes wrote past the end", kernels->name, n);
+            checked++;
+        }
+    }
+
+    printf("kernel_checks=%u\n", checked);
+    free(original);
+    free(reference);
+    free(channels);
+    free(payload);
+    free(extracted);
+}
+
+/* The same random encode and decode through every path */
+static void diff_paths_run(TestRand *rand, const char *dir)
+{
+    static const TestCover formats[] =
+    {
+        { "bmp", 0, 0, 3, 0 }, { "bmp", 0, 0, 4, 0 }, { "ppm", 0, 0, 3, 0 }, { "pgm", 0, 0, 1, 0 },
+        { "tga", 0, 0, 1, 0 }, { "tga", 0, 0, 3, 0 }, { "tga", 0, 0, 4, 0 },
+        { "png", 0, 0, 1, 0 }, { "png", 0, 0, 3, 0 }, { "png", 0, 0, 4, 0 },
+    };
+    char cover_fname[TEST_PATH_SIZE], secret_fname[TEST_PATH_SIZE], decode_fname[TEST_PATH_SIZE];
+    char stego_fnames[e_path_count][TEST_PATH_SIZE];
+    char base[32];
+
+    for(uint c = 0; c < DIFF_IMAGE_CASES; c++)
+    {
+        TestCover cover = formats[test_rand_range(rand, 0, sizeof (formats) / sizeof (formats[0]) - 1)];
+        uint mode = test_rand_range(rand, 0, 2);
+        uint capacity, size;
+        TestJob job;
+
+        cover.width = test_rand_range(rand, 40, 300);
+        cover.height = test_rand_range(rand, 40, 200);
+        cover.seed = test_rand(rand);
+
+        snprintf(base, sizeof (base), "cover%s", test_cover_extn(&cover));
+        test_path(cover_fname, dir, base);
+        test_path(secret_fname, dir, "secret.txt");
+        test_path(decode_fname, dir, "decode.txt");
+
+        memset(&job, 0, sizeof (job));
+        job.cover_fname = cover_fname;
+        job.secret_fname = secret_fname;
+        job.decode_fname = decode_fname;
+        job.hamming_k = mode == 1 ? test_rand_range(rand, 2, 8) : 0;
+        job.adaptive = mode == 2;
+        job.key_phrase = mode == 2 ? "differential" : NULL;
+
+        if(test_make_cover(cover_fname, &cover) == e_failure)
+        {
+            TEST_CHECK(0, "case %u: cover not written", c);
+            continue;
+        }
+        capacity = job.adaptive ? test_capacity(cover_fname, 0) / 16 : test_capacity(cover_fname, job.hamming_k);
+        size = test_rand_range(rand, 0, capacity);
+        test_make_secret(secret_fname, size, cover.seed);
+
+        for(int path = 0; path < e_path_count; path++)
+        {
+            snprintf(base, sizeof (base), "stego-%s%s", diff_path_names[path], test_cover_extn(&cover));
+            test_path(stego_fnames[path], dir, base);
+            remove(stego_fnames[path]);
+
+            job.stego_fname = stego_fnames[path];
+            diff_path_job(&job, path);
+            TEST_CHECK(test_encode(&job) == e_success, "case %u %s %ux%u hamming=%u adaptive=%d size=%u: encoding through %s failed",
+                       c, cover.format, cover.width, cover.height, job.hamming_k, job.adaptive, size, diff_path_names[path]);
+            TEST_CHECK(path == e_path_sync || test_same_file(stego_fnames[e_path_sync], stego_fnames[path]),
+                       "case %u %s %ux%u hamming=%u adaptive=%d size=%u: %s stego image differs from sync",
+                       c, cover.format, cover.width, cover.height, job.hamming_k, job.adaptive, size, diff_path_names[path]);
+        }
+
+        /* Every path decodes the image of the sync path */
+        job.stego_fname = stego_fnames[e_path_sync];
+        for(int path = 0; path < e_path_count; path++)
+        {
+            remove(decode_fname);
+            diff_path_job(&job, path);
+            TEST_CHECK(test_decode(&job) == e_success && test_same_file(secret_fname, decode_fname),
+                       "case %u %s %ux%u hamming=%u adaptive=%d size=%u: decoding through %s differs",
+                       c, cover.format, cover.width, cover.height, job.hamming_k, job.adaptive, size, diff_path_names[path]);
+        }
+    }
+    unsetenv("STEGO_IO_POOL");
+
+    printf("path_cases=%u\n", DIFF_IMAGE_CASES);
+}
+
+/* Run a function with stdout going to a file */
+static void diff_capture(const char *fname, void (*run)(void *), void *arg)
+{
+    int saved = dup(STDOUT_FILENO);
+    int fd = open(fname, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+
+    fflush(stdout);
+    dup2(fd, STDOUT_FILENO);
+    close(fd);
+    run(arg);
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+}
+
+/* Threaded analysis */
+static void diff_analyze_threaded(void *arg)
+{
+    AnalyzeInfo *anaInfo = arg;
+
+    do_analysis(anaInfo);
+}
+
+/* One image after the other on the calling thread, printed the way do_analysis does */
+static void diff_analyze_serial(void *arg)
+{
+    AnalyzeInfo *anaInfo = arg;
+    AnalyzeResult result;
+    char label[TEST_PATH_SIZE + 64];
+
+    for(uint i = 0; i < anaInfo->image_count; i++)
+    {
+        memset(&result, 0, sizeof (result));
+        if(analyze_image(anaInfo->image_fnames[i], &result) == e_failure)
+        {
+            printf("image=%s error=unsupported\n", anaInfo->image_fnames[i]);
+            continue;
+        }
+
+        snprintf(label, sizeof (label), "image=%s format=%s", anaInfo->image_fnames[i], result.format_name);
+        metrics_print(label, &result.report, 0);
+    }
+}
+
+/* Threaded analysis against the serial one */
+static void diff_analyze_run(TestRand *rand, const char *dir)
+{
+    static const char *const formats[] = { "bmp", "ppm", "tga", "png" };
+    static char fnames[DIFF_ANALYZE_IMAGES][TEST_PATH_SIZE];
+    char *image_fnames[DIFF_ANALYZE_IMAGES + 1];
+    char threaded_fname[TEST_PATH_SIZE], serial_fname[TEST_PATH_SIZE], base[32];
+    AnalyzeInfo anaInfo;
+
+    for(uint i = 0; i < DIFF_ANALYZE_IMAGES; i++)
+    {
+        TestCover cover = { formats[i % 4], 0, 0, 3, test_rand(rand) };
+
+        cover.width = test_rand_range(rand, 8, 200);
+        cover.height = test_rand_range(rand, 8, 200);
+        snprintf(base, sizeof (base), "analyze%u%s", i, test_cover_extn(&cover));
+        test_make_cover(test_path(fnames[i], dir, base), &cover);
+        image_fnames[i] = fnames[i];
+    }
+    image_fnames[DIFF_ANALYZE_IMAGES] = NULL;
+
+    memset(&anaInfo, 0, sizeof (anaInfo));
+    anaInfo.image_fnames = image_fnames;
+    anaInfo.image_count = DIFF_ANALYZE_IMAGES;
+
+    diff_capture(test_path(threaded_fname, dir, "threaded.txt"), diff_analyze_threaded, &anaInfo);
+    diff_capture(test_path(serial_fname, dir, "serial.txt"), diff_analyze_serial, &anaInfo);
+    TEST_CHECK(test_same_file(threaded_fname, serial_fname), "threaded analysis differs from the serial one");
+
+    printf("analyze_images=%u\n", DIFF_ANALYZE_IMAGES);
+}
+
+/*
+ * Usage: test_differential [seed]
+ * Bit kernels, I/O backends, memory streams and the analysis
+ * threads are each run against the plain implementation on
+ * random inputs, and must give the same bytes.
+ */
+int main(int argc, char *argv[])
+{
+    unsigned long long seed = argc > 1 ? strtoull(argv[1], NULL, 0) : 0xD1FF;
+    char dir[TEST_PATH_SIZE];
+    TestRand rand;
+
+    if(test_temp_dir(dir, sizeof (dir)) == e_failure)
+    {
+        perror("mkdtemp");
+        return 2;
+    }
+
+    test_rand_seed(&rand, seed);
+    diff_kernels_run(&rand);
+    diff_paths_run(&rand, dir);
+    diff_analyze_run(&rand, dir);
+    test_remove_dir(dir);
+
+    printf("seed=%#llx failures=%d\n", seed, test_failures);
+
+    return test_failures ? 1 : 0;
+}
@@ -0,0 +1,309 @@
+/* This file contains the golden output test: stego images of a fixed matrix of covers and payloads must not change */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "test_support.h"
+
+#define GOLDEN_MAX_CASES 256
+#define GOLDEN_NAME_SIZE 96
+
+/* Covers of the matrix, odd sizes give BMP row padding and partial texture blocks */
+static const TestCover golden_covers[] =
+{
+    { "bmp", 37, 29, 3, 1 },
+    { "bmp", 40, 30, 4, 2 },
+    { "ppm", 41, 33, 3, 3 },
+    { "pgm", 96, 64, 1, 4 },
+    { "tga", 45, 31, 3, 5 },
+    { "tga", 32, 32, 4, 6 },
+    { "tga", 96, 64, 1, 7 },
+    { "png", 64, 48, 1, 8 },
+    { "png", 40, 30, 2, 9 },
+    { "png", 41, 29, 3, 10 },
+    { "png", 36, 28, 4, 11 },
+};
+
+/* Embedding modes, each with payload sizes as fractions of the layout capacity */
+typedef struct _GoldenMode
+{
+    const char *name;
+    int adaptive;
+    uint hamming_k;
+    uint capacity_div;          // Capacity of the plain layout divided by this, 0 for the layout's own
+    uint fractions[4];          // Payload in 1/8 of the capacity, ended by 0
+    int with_empty;
+} GoldenMode;
+
+static const GoldenMode golden_modes[] =
+{
+    { "lsb", 0, 0, 0, { 1, 4, 8, 0 }, 1 },
+    { "hamming3", 0, 3, 0, { 1, 8, 0 }, 0 },
+    { "hamming8", 0, 8, 0, { 8, 0 }, 0 },
+    { "adaptive", 1, 0, 4, { 1, 8, 0 }, 0 },
+};
+
+/* Golden hashes read from the file */
+typedef struct _GoldenTable
+{
+    char names[GOLDEN_MAX_CASES][GOLDEN_NAME_SIZE];
+    unsigned long long hashes[GOLDEN_MAX_CASES];
+    uint count;
+} GoldenTable;
+
+/* Test options */
+typedef struct _GoldenOptions
+{
+    const char *golden_fname;
+    const char *repo_dir;       // Holds beautiful.bmp and secret.txt, NULL to skip them
+    IoBackend io_backend;
+    int in_memory;
+    int update;
+} GoldenOptions;
+
+/* Read name and hash pairs, lines starting with # are comments */
+static Status golden_load(const char *fname, GoldenTable *table)
+{
+    FILE *fptr = fopen(fname, "r");
+    char line[256];
+
+    table->count = 0;
+    if(fptr == NULL)
+    {
+        return e_failure;
+    }
+
+    while(fgets(line, sizeof (line), fptr) != NULL && table->count < GOLDEN_MAX_CASES)
+    {
+        if(line[0] == '#' || line[0] == '\n')
+        {
+            continue;
+        }
+        if(sscanf(line, "%95s %llx", table->names[table->count], &table->hashes[table->count]) == 2)
+        {
+            table->count++;
+        }
+    }
+    fclose(fptr);
+
+    return e_success;
+}
+
+/* Find the golden hash of a case */
+static int golden_find(const GoldenTable *table, const char *name, unsigned long long *hash)
+{
+    for(uint i = 0; i < table->count; i++)
+    {
+        if(strcmp(table->names[i], name) == 0)
+        {
+            *hash = table->hashes[i];
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* Check one case against its golden hash, or record it when updating */
+static void golden_check(const GoldenOptions *options, const GoldenTable *golden, GoldenTable *seen,
+                         const char *name, unsigned long long hash)
+{
+    unsigned long long expected;
+
+    if(seen->count < GOLDEN_MAX_CASES)
+    {
+        snprintf(seen->names[seen->count], GOLDEN_NAME_SIZE, "%s", name);
+        seen->hashes[seen->count++] = hash;
+    }
+
+    if(options->update)
+    {
+        return;
+    }
+
+    TEST_CHECK(golden_find(golden, name, &expected), "%s: no golden hash, run with --update", name);
+    TEST_CHECK(!golden_find(golden, name, &expected) || expected == hash,
+               "%s: stego hash %016llx, golden %016llx", name, hash, expected);
+}
+
+/* Encode, hash and decode one case */
+static void golden_run(const GoldenOptions *options, const GoldenTable *golden, GoldenTable *seen,
+                       const char *name, TestJob *job, int raw_layout)
+{
+    unsigned long long hash;
+
+    remove(job->stego_fname);
+    remove(job->decode_fname);
+
+    if(test_encode(job) == e_failure)
+    {
+        TEST_CHECK(0, "%s: encoding failed", name);
+        return;
+    }
+
+    /* PNG hashes cover the pixels only, the deflate stream depends on the zlib build */
+    hash = raw_layout ? test_hash_file(job->stego_fname) : test_hash_span(job->stego_fname);
+    golden_check(options, golden, seen, name, hash);
+
+    TEST_CHECK(test_decode(job) == e_success, "%s: decoding failed", name);
+    TEST_CHECK(test_same_file(job->secret_fname, job->decode_fname), "%s: decoded data differs", name);
+}
+
+/* Run every mode and payload size on one cover */
+static void golden_cover(const GoldenOptions *options, const GoldenTable *golden, GoldenTable *seen,
+                         const char *dir, const TestCover *cover)
+{
+    char cover_fname[TEST_PATH_SIZE], secret_fname[TEST_PATH_SIZE], stego_fname[TEST_PATH_SIZE], decode_fname[TEST_PATH_SIZE];
+    char base[64], name[GOLDEN_NAME_SIZE];
+    int raw_layout = strcmp(cover->format, "png") != 0;
+    TestJob job;
+
+    snprintf(base, sizeof (base), "cover%s", test_cover_extn(cover));
+    test_path(cover_fname, dir, base);
+    snprintf(base, sizeof (base), "stego%s", test_cover_extn(cover));
+    test_path(stego_fname, dir, base);
+    test_path(secret_fname, dir, "secret.txt");
+    test_path(decode_fname, dir, "decode.txt");
+
+    if(test_make_cover(cover_fname, cover) == e_failure)
+    {
+        TEST_CHECK(0, "%s: cover not written", cover_fname);
+        return;
+    }
+
+    memset(&job, 0, sizeof (job));
+    job.cover_fname = cover_fname;
+    job.secret_fname = secret_fname;
+    job.stego_fname = stego_fname;
+    job.decode_fname = decode_fname;
+    job.io_backend = options->io_backend;
+    job.in_memory = options->in_memory;
+
+    for(uint m = 0; m < sizeof (golden_modes) / sizeof (golden_modes[0]); m++)
+    {
+        const GoldenMode *mode = &golden_modes[m];
+        uint capacity = mode->capacity_div ? test_capacity(cover_fname, 0) / mode->capacity_div : test_capacity(cover_fname, mode->hamming_k);
+
+        job.adaptive = mode->adaptive;
+        job.key_phrase = mode->adaptive ? "golden" : NULL;
+        job.hamming_k = mode->hamming_k;
+
+        for(int f = mode->with_empty ? -1 : 0; f < 4 && (f < 0 || mode->fractions[f] != 0); f++)
+        {
+            uint size = f < 0 ? 0 : capacity * mode->fractions[f] / 8;
+
+            snprintf(name, sizeof (name), "%s-%ux%ux%u/%s/%u", cover->format, cover->width, cover->height,
+                     cover->channels, mode->name, size);
+            if(test_make_secret(secret_fname, size, cover->seed * 1000 + size) == e_failure)
+            {
+                TEST_CHECK(0, "%s: secret not written", name);
+                continue;
+            }
+            golden_run(options, golden, seen, name, &job, raw_layout);
+        }
+    }
+}
+
+/* Read the options */
+static Status golden_options(char *argv[], GoldenOptions *options)
+{
+    memset(options, 0, sizeof (GoldenOptions));
+
+    for(int i = 1; argv[i] != NULL; i++)
+    {
+        if(strcmp(argv[i], "--update") == 0)
+            options->update = 1;
+        else if(strcmp(argv[i], "--memory") == 0)
+            options->in_memory = 1;
+        else if(strcmp(argv[i], "--io=uring") == 0)
+            options->io_backend = e_io_uring;
+        else if(strcmp(argv[i], "--io=sync") == 0)
+            options->io_backend = e_io_sync;
+        else if(strncmp(argv[i], "--repo=", 7) == 0)
+            options->repo_dir = argv[i] + 7;
+        else if(options->golden_fname == NULL && argv[i][0] != '-')
+            options->golden_fname = argv[i];
+        else
+            return e_failure;
+    }
+
+    return options->golden_fname != NULL ? e_success : e_failure;
+}
+
+/*
+ * Usage: test_golden <golden file> [--repo=dir] [--io=sync|uring] [--memory] [--update]
+ * Every backend, kernel and input path must give the stego images
+ * recorded in the golden file. --update rewrites the file from the
+ * current build, only do that for an intended change of the output.
+ */
+int main(int argc, char *argv[])
+{
+    static GoldenTable golden, seen;
+    GoldenOptions options;
+    char dir[TEST_PATH_SIZE];
+
+    (void) argc;
+    if(golden_options(argv, &options) == e_failure)
+    {
+        fprintf(stderr, "Usage: %s <golden file> [--repo=dir] [--io=sync|uring] [--memory] [--update]\n", argv[0]);
+        return 2;
+    }
+
+    if(!options.update && golden_load(options.golden_fname, &golden) == e_failure)
+    {
+        fprintf(stderr, "ERROR: Unable to read %s\n", options.golden_fname);
+        return 2;
+    }
+    if(test_temp_dir(dir, sizeof (dir)) == e_failure)
+    {
+        perror("mkdtemp");
+        return 2;
+    }
+
+    for(uint c = 0; c < sizeof (golden_covers) / sizeof (golden_covers[0]); c++)
+    {
+        golden_cover(&options, &golden, &seen, dir, &golden_covers[c]);
+    }
+
+    /* The sample cover and secret of the project */
+    if(options.repo_dir != NULL)
+    {
+        char cover_fname[TEST_PATH_SIZE], secret_fname[TEST_PATH_SIZE], stego_fname[TEST_PATH_SIZE], decode_fname[TEST_PATH_SIZE];
+        TestJob job;
+
+        memset(&job, 0, sizeof (job));
+        job.cover_fname = test_path(cover_fname, options.repo_dir, "beautiful.bmp");
+        job.secret_fname = test_path(secret_fname, options.repo_dir, "secret.txt");
+        job.stego_fname = test_path(stego_fname, dir, "stego.bmp");
+        job.decode_fname = test_path(decode_fname, dir, "decode.txt");
+        job.io_backend = options.io_backend;
+        job.in_memory = options.in_memory;
+        golden_run(&options, &golden, &seen, "beautiful.bmp/lsb/secret.txt", &job, 1);
+    }
+
+    test_remove_dir(dir);
+
+    if(options.update)
+    {
+        FILE *fptr = fopen(options.golden_fname, "w");
+
+        if(fptr == NULL)
+        {
+            perror("fopen");
+            return 2;
+        }
+        fprintf(fptr, "# FNV-1a 64 of the stego images of test_golden, PNG cases hash the pixel span\n");
+        for(uint i = 0; i < seen.count; i++)
+        {
+            fprintf(fptr, "%s %016llx\n", seen.names[i], seen.hashes[i]);
+        }
+        fclose(fptr);
+        printf("cases=%u written=%s\n", seen.count, options.golden_fname);
+
+        return test_failures ? 1 : 0;
+    }
+
+    printf("cases=%u failures=%d\n", seen.count, test_failures);
+
+    return test_failures ? 1 : 0;
+}
@@ -0,0 +1,271 @@
+/* This file contains the property based round trip test over random covers, payloads and embedding modes */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "test_support.h"
+#include "../plan.h"
+
+#define ROUNDTRIP_CASES 300
+#define ROUNDTRIP_MAX_SIZE 80
+
+/* Cover formats with their channel counts */
+static const struct
+{
+    const char *format;
+    uint channels;
+} roundtrip_formats[] =
+{
+    { "bmp", 3 }, { "bmp", 4 }, { "ppm", 3 }, { "pgm", 1 },
+    { "tga", 1 }, { "tga", 3 }, { "tga", 4 },
+    { "png", 1 }, { "png", 2 }, { "png", 3 }, { "png", 4 },
+};
+
+/* Pick a payload size, the edges of the range more often than the rest */
+static uint roundtrip_size(TestRand *rand, uint capacity)
+{
+    switch(test_rand_range(rand, 0, 5))
+    {
+        case 0:
+            return 0;
+        case 1:
+            return capacity > 0 ? 1 : 0;
+        case 2:
+            return capacity;
+        case 3:
+            return capacity > 0 ? capacity - 1 : 0;
+        default:
+            return test_rand_range(rand, 0, capacity);
+    }
+}
+
+/* Stego bytes may only differ from the cover in the LSBs of the span */
+static int roundtrip_lsb_only(const char *cover_fname, const char *stego_fname)
+{
+    long cover_size, stego_size;
+    unsigned char *cover = test_read_file(cover_fname, &cover_size);
+    unsigned char *stego = test_read_file(stego_fname, &stego_size);
+    int ok = cover != NULL && stego != NULL && cover_size == stego_size;
+
+    for(long i = 0; ok && i < cover_size; i++)
+    {
+        ok = (cover[i] ^ stego[i]) <= 1;
+    }
+
+    free(cover);
+    free(stego);
+
+    return ok;
+}
+
+/* Whether -p says the payload fits the cover */
+static int roundtrip_plan_fits(const char *cover_fname, uint size, uint hamming_k)
+{
+    PlanInfo planInfo;
+    CapacityPlan plan;
+
+    memset(&planInfo, 0, sizeof (planInfo));
+    planInfo.size_secret_file = size;
+    planInfo.hamming_k = hamming_k;
+
+    return plan_cover_capacity(cover_fname, &planInfo, &plan) == e_success && plan.fits;
+}
+
+/* Run one random case */
+static void roundtrip_case(TestRand *rand, const char *dir, uint case_no)
+{
+    char cover_fname[TEST_PATH_SIZE], secret_fname[TEST_PATH_SIZE], stego_fname[TEST_PATH_SIZE], decode_fname[TEST_PATH_SIZE];
+    char base[32], key[16];
+    uint f = test_rand_range(rand, 0, sizeof (roundtrip_formats) / sizeof (roundtrip_formats[0]) - 1);
+    TestCover cover = { roundtrip_formats[f].format, 0, 0, roundtrip_formats[f].channels, 0 };
+    uint mode = test_rand_range(rand, 0, 2);
+    uint capacity, size;
+    TestJob job;
+
+    cover.width = test_rand_range(rand, 1, ROUNDTRIP_MAX_SIZE);
+    cover.height = test_rand_range(rand, 1, ROUNDTRIP_MAX_SIZE);
+    cover.seed = test_rand(rand);
+
+    snprintf(base, sizeof (base), "cover%s", test_cover_extn(&cover));
+    test_path(cover_fname, dir, base);
+    snprintf(base, sizeof (base), "stego%s", test_cover_extn(&cover));
+    test_path(stego_fname, dir, base);
+    test_path(secret_fname, dir, "secret.txt");
+    test_path(decode_fname, dir, "decode.txt");
+    remove(stego_fname);
+    remove(decode_fname);
+
+    memset(&job, 0, sizeof (job));
+    job.cover_fname = cover_fname;
+    job.secret_fname = secret_fname;
+    job.stego_fname = stego_fname;
+    job.decode_fname = decode_fname;
+    job.io_backend = test_rand_range(rand, 0, 1) ? e_io_uring : e_io_sync;
+
+    /* Plain, Hamming or adaptive with a random key */
+    if(mode == 1)
+    {
+        job.hamming_k = test_rand_range(rand, 2, 8);
+    }
+    else if(mode == 2)
+    {
+        snprintf(key, sizeof (key), "k%08x", test_rand(rand));
+        job.adaptive = 1;
+        job.key_phrase = key;
+    }
+
+    if(test_make_cover(cover_fname, &cover) == e_failure)
+    {
+        TEST_CHECK(0, "case %u: cover not written", case_no);
+        return;
+    }
+
+    /* Adaptive capacity depends on the texture, stay well below the plain one */
+    capacity = test_capacity(cover_fname, job.hamming_k);
+    if(job.adaptive)
+    {
+        capacity = cover.width >= 32 && cover.height >= 32 ? capacity / 16 : 0;
+    }
+    size = roundtrip_size(rand, capacity);
+
+    #define CASE_FMT "case %u %s %ux%ux%u hamming=%u adaptive=%d io=%d size=%u capacity=%u: "
+    #define CASE_ARGS case_no, cover.format, cover.width, cover.height, cover.channels, job.hamming_k, job.adaptive, job.io_backend, size, capacity
+
+    /* A payload past the capacity is refused */
+    if(!job.adaptive)
+    {
+        test_make_secret(secret_fname, capacity + 1, cover.seed + 1);
+        TEST_CHECK(test_encode(&job) == e_failure, CASE_FMT "one byte past the capacity was accepted", CASE_ARGS);
+        TEST_CHECK(!roundtrip_plan_fits(cover_fname, capacity + 1, job.hamming_k), CASE_FMT "planner fits one byte past the capacity", CASE_ARGS);
+        remove(stego_fname);
+    }
+
+    if(test_make_secret(secret_fname, size, cover.seed) == e_failure)
+    {
+        TEST_CHECK(0, CASE_FMT "secret not written", CASE_ARGS);
+        return;
+    }
+
+    /* Covers about the size of the header may refuse even an empty secret, what they accept must decode */
+    if(capacity == 0)
+    {
+        Status ret = test_encode(&job);
+
+        TEST_CHECK(job.adaptive || roundtrip_plan_fits(cover_fname, size, job.hamming_k) == (ret == e_success),
+                   CASE_FMT "planner and encoder disagree", CASE_ARGS);
+        if(ret == e_success)
+        {
+            TEST_CHECK(test_decode(&job) == e_success && test_same_file(secret_fname, decode_fname),
+                       CASE_FMT "accepted cover does not round trip", CASE_ARGS);
+        }
+        return;
+    }
+
+    if(test_encode(&job) == e_failure)
+    {
+        TEST_CHECK(0, CASE_FMT "encoding failed", CASE_ARGS);
+        return;
+    }
+    TEST_CHECK(job.adaptive || roundtrip_plan_fits(cover_fname, size, job.hamming_k), CASE_FMT "planner refuses an accepted payload", CASE_ARGS);
+    TEST_CHECK(test_decode(&job) == e_success, CASE_FMT "decoding failed", CASE_ARGS);
+    TEST_CHECK(test_same_file(secret_fname, decode_fname), CASE_FMT "decoded data differs", CASE_ARGS);
+
+    if(strcmp(cover.format, "png") != 0)
+    {
+        TEST_CHECK(roundtrip_lsb_only(cover_fname, stego_fname), CASE_FMT "changes beyond the LSBs", CASE_ARGS);
+    }
+
+    /* Another key must not give the secret back */
+    if(job.adaptive && size >= 8)
+    {
+        snprintf(key, sizeof (key), "wrong");
+        remove(decode_fname);
+        TEST_CHECK(test_decode(&job) == e_failure || !test_same_file(secret_fname, decode_fname),
+                   CASE_FMT "decoded with the wrong key", CASE_ARGS);
+    }
+
+    #undef CASE_FMT
+    #undef CASE_ARGS
+}
+
+/* Covers too small for the header fail to decode instead of reading past the span */
+static void roundtrip_short_span(const char *dir)
+{
+    char cover_fname[TEST_PATH_SIZE], decode_fname[TEST_PATH_SIZE];
+    char base[32];
+    TestJob job;
+
+    for(uint f = 0; f < sizeof (roundtrip_formats) / sizeof (roundtrip_formats[0]); f++)
+    {
+        TestCover cover = { roundtrip_formats[f].format, 2, 2, roundtrip_formats[f].channels, f };
+
+        snprintf(base, sizeof (base), "short%u%s", f, test_cover_extn(&cover));
+        test_make_cover(test_path(cover_fname, dir, base), &cover);
+
+        memset(&job, 0, sizeof (job));
+        job.stego_fname = cover_fname;
+        job.decode_fname = test_path(decode_fname, dir, "short.out");
+        TEST_CHECK(test_decode(&job) == e_failure, "%s %u channels: header decoded from a short span", cover.format, cover.channels);
+    }
+}
+
+/* A stego image that can not be written fails the encode instead of leaving it truncated */
+static void roundtrip_full_disk(const char *dir)
+{
+    char cover_fname[TEST_PATH_SIZE], secret_fname[TEST_PATH_SIZE];
+    char base[32];
+    TestJob job;
+
+    test_make_secret(test_path(secret_fname, dir, "full.txt"), 20, 1);
+    for(uint f = 0; f < sizeof (roundtrip_formats) / sizeof (roundtrip_formats[0]); f++)
+    {
+        TestCover cover = { roundtrip_formats[f].format, 40, 30, roundtrip_formats[f].channels, f };
+
+        snprintf(base, sizeof (base), "full%u%s", f, test_cover_extn(&cover));
+        test_make_cover(test_path(cover_fname, dir, base), &cover);
+
+        memset(&job, 0, sizeof (job));
+        job.cover_fname = cover_fname;
+        job.secret_fname = secret_fname;
+        job.stego_fname = "/dev/full";
+        TEST_CHECK(test_encode(&job) == e_failure, "%s %u channels: encoding to a full disk succeeded", cover.format, cover.channels);
+        job.io_backend = e_io_uring;
+        TEST_CHECK(test_encode(&job) == e_failure, "%s %u channels: io_uring encoding to a full disk succeeded", cover.format, cover.channels);
+    }
+}
+
+/*
+ * Usage: test_roundtrip [cases] [seed]
+ * Properties checked on every random case: a payload up to the
+ * capacity decodes to the same bytes, one byte more is refused,
+ * raw layout covers only change in their LSBs, and adaptive images
+ * do not decode with another key. Covers smaller than the header
+ * do not decode at all, and encoding to a full disk fails. A failure prints the seed, rerun
+ * with it to get the same cases.
+ */
+int main(int argc, char *argv[])
+{
+    uint cases = argc > 1 ? strtoul(argv[1], NULL, 0) : ROUNDTRIP_CASES;
+    unsigned long long seed = argc > 2 ? strtoull(argv[2], NULL, 0) : 0x5EED;
+    char dir[TEST_PATH_SIZE];
+    TestRand rand;
+
+    if(test_temp_dir(dir, sizeof (dir)) == e_failure)
+    {
+        perror("mkdtemp");
+        return 2;
+    }
+
+    test_rand_seed(&rand, seed);
+    for(uint i = 0; i < cases; i++)
+    {
+        roundtrip_case(&rand, dir, i);
+    }
+    roundtrip_short_span(dir);
+    roundtrip_full_disk(dir);
+    test_remove_dir(dir);
+
+    printf("cases=%u seed=%#llx failures=%d\n", cases, seed, test_failures);
+
+    return test_failures ? 1 : 0;
+}
@@ -0,0 +1,584 @@
+/* This file contains codes related to the helpers shared by the test programs */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <zlib.h>
+#include "test_support.h"
+#include "../encode.h"
+#include "../decode.h"
+#include "../cover.h"
+
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+#define TEST_BLOCK 8
+
+int test_failures;
+
+/* Noise amplitude of the cover blocks, from flat to busy */
+static const uint test_noise[] = { 0, 3, 16, 96 };
+
+/* Function Definitions */
+
+/* Function definition to seed the generator */
+void test_rand_seed(TestRand *rand, unsigned long long seed)
+{
+    rand->state = seed * 2862933555777941757ULL + 3037000493ULL;
+}
+
+/* Function definition to get the next 32 random bits, splitmix64 */
+uint test_rand(TestRand *rand)
+{
+    unsigned long long z = (rand->state += 0x9E3779B97F4A7C15ULL);
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+    return (z ^ (z >> 31)) >> 32;
+}
+
+/* Function definition to get a random number in [lo, hi] */
+uint test_rand_range(TestRand *rand, uint lo, uint hi)
+{
+    return lo + test_rand(rand) % (hi - lo + 1);
+}
+
+/* Function definition to fill a buffer with random bytes */
+void test_rand_fill(TestRand *rand, unsigned char *buf, size_t n)
+{
+    for(size_t i = 0; i < n; i++)
+    {
+        buf[i] = test_rand(rand);
+    }
+}
+
+/* Function definition to create a temporary directory */
+Status test_temp_dir(char *dir, uint size)
+{
+    const char *tmp = getenv("TMPDIR");
+
+    snprintf(dir, size, "%s/stego-test-XXXXXX", tmp != NULL && *tmp != '\0' ? tmp : "/tmp");
+
+    return mkdtemp(dir) != NULL ? e_success : e_failure;
+}
+
+/* Function definition to remove the temporary directory */
+void test_remove_dir(const char *dir)
+{
+    DIR *dirp = opendir(dir);
+    struct dirent *entry;
+    char fname[TEST_PATH_SIZE];
+
+    if(dirp == NULL)
+    {
+        return;
+    }
+
+    while((entry = readdir(dirp)) != NULL)
+    {
+        if(strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0)
+        {
+            unlink(test_path(fname, dir, entry->d_name));
+        }
+    }
+    closedir(dirp);
+    rmdir(dir);
+}
+
+/* Function definition to join a directory and a file name */
+const char *test_path(char *buf, const char *dir, const char *name)
+{
+    snprintf(buf, TEST_PATH_SIZE, "%s/%s", dir, name);
+
+    return buf;
+}
+
+/* Function definition to get the file extension of a test cover */
+const char *test_cover_extn(const TestCover *cover)
+{
+    static const char *const names[] = { "bmp", "ppm", "pgm", "tga", "png" };
+    static const char *const extns[] = { ".bmp", ".ppm", ".pgm", ".tga", ".png" };
+
+    for(uint i = 0; i < sizeof (names) / sizeof (names[0]); i++)
+    {
+        if(strcmp(cover->format, names[i]) == 0)
+        {
+            return extns[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* Generate the rows of a cover, row_len channel bytes per row */
+static unsigned char *test_cover_pixels(const TestCover *cover, uint row_len)
+{
+    unsigned char *pixels = malloc((size_t) row_len * cover->height + 1);
+    uint blocks_x = (cover->width + TEST_BLOCK - 1) / TEST_BLOCK;
+    TestRand rand;
+
+    if(pixels == NULL)
+    {
+        return NULL;
+    }
+    test_rand_seed(&rand, cover->seed);
+
+    for(uint y = 0; y < cover->height; y++)
+    {
+        for(uint x = 0; x < cover->width; x++)
+        {
+            /* Every block gets its own noise amplitude */
+            uint block = (y / TEST_BLOCK) * blocks_x + x / TEST_BLOCK;
+            uint amplitude = test_noise[(block * 2654435761u + cover->seed) % 4];
+
+            for(uint c = 0; c < cover->channels; c++)
+            {
+                int value = (x * 3 + y * 2 + c * 40) & 0xFF;
+
+                if(amplitude > 0)
+                {
+                    value += (int) test_rand_range(&rand, 0, 2 * amplitude) - (int) amplitude;
+                }
+                pixels[(size_t) y * row_len + x * cover->channels + c] = value < 0 ? 0 : (value > 255 ? 255 : value);
+            }
+        }
+    }
+
+    return pixels;
+}
+
+/* Store a little endian value */
+static void test_put_le(unsigned char *buf, uint value, int width)
+{
+    for(int i = 0; i < width; i++)
+    {
+        buf[i] = value >> (8 * i);
+    }
+}
+
+/* Store a big endian 32 bit value */
+static void test_put_be(unsigned char *buf, uint value)
+{
+    for(int i = 0; i < 4; i++)
+    {
+        buf[i] = value >> (8 * (3 - i));
+    }
+}
+
+/* Write one PNG chunk with its CRC */
+static void test_png_chunk(FILE *fptr, const char *type, const unsigned char *data, uint len)
+{
+    unsigned char word[4];
+    uLong crc = crc32(0, (const Bytef *) type, 4);
+
+    crc = crc32(crc, data, len);
+    test_put_be(word, len);
+    fwrite(word, 1, 4, fptr);
+    fwrite(type, 1, 4, fptr);
+    if(len > 0)
+        fwrite(data, 1, len, fptr);
+    test_put_be(word, crc);
+    fwrite(word, 1, 4, fptr);
+}
+
+/* Write a PNG cover, rows cycle through the None, Sub and Up filters */
+static Status test_write_png(FILE *fptr, const TestCover *cover, const unsigned char *pixels)
+{
+    static const unsigned char color_types[] = { 0, 0, 4, 2, 6 };
+    static const unsigned char signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    uint row_len = cover->width * cover->channels;
+    size_t raw_len = (size_t) (row_len + 1) * cover->height;
+    unsigned char *raw = malloc(raw_len);
+    uLongf packed_len = compressBound(raw_len);
+    unsigned char *packed = malloc(packed_len);
+    unsigned char ihdr[13];
+
+    if(raw == NULL || packed == NULL)
+    {
+        free(raw);
+        free(packed);
+        return e_failure;
+    }
+
+    for(uint y = 0; y < cover->height; y++)
+    {
+        const unsigned char *row = pixels + (size_t) y * row_len;
+        unsigned char *out = raw + (size_t) y * (row_len + 1);
+        uint filter = y == 0 ? 0 : y % 3;
+
+        out[0] = filter;
+        for(uint i = 0; i < row_len; i++)
+        {
+            uint left = i >= cover->channels ? row[i - cover->channels] : 0;
+            uint up = y > 0 ? pixels[(size_t) (y - 1) * row_len + i] : 0;
+
+            out[i + 1] = filter == 0 ? row[i] : row[i] - (filter == 1 ? left : up);
+        }
+    }
+
+    if(compress2(packed, &packed_len, raw, raw_len, 6) != Z_OK)
+    {
+        free(raw);
+        free(packed);
+        return e_failure;
+    }
+
+    test_put_be(ihdr, cover->width);
+    test_put_be(ihdr + 4, cover->height);
+    ihdr[8] = 8;
+    ihdr[9] = color_types[cover->channels];
+    ihdr[10] = ihdr[11] = ihdr[12] = 0;
+
+    fwrite(signature, 1, sizeof (signature), fptr);
+    test_png_chunk(fptr, "IHDR", ihdr, sizeof (ihdr));
+    test_png_chunk(fptr, "tEXt", (const unsigned char *) "Comment\0stego test", 18);
+    test_png_chunk(fptr, "IDAT", packed, packed_len);
+    test_png_chunk(fptr, "IEND", NULL, 0);
+
+    free(raw);
+    free(packed);
+
+    return e_success;
+}
+
+/* Function definition to write a synthetic cover image */
+Status test_make_cover(const char *fname, const TestCover *cover)
+{
+    int bmp = strcmp(cover->format, "bmp") == 0;
+    uint row_len = bmp ? (cover->width * cover->channels + 3) & ~3u : cover->width * cover->channels;
+    unsigned char *pixels = test_cover_pixels(cover, row_len);
+    FILE *fptr = fopen(fname, "w");
+    Status ret = e_success;
+
+    if(pixels == NULL || fptr == NULL)
+    {
+        free(pixels);
+        if(fptr != NULL)
+            fclose(fptr);
+        return e_failure;
+    }
+
+    if(bmp)
+    {
+        unsigned char header[54] = { 'B', 'M' };
+        uint span = row_len * cover->height;
+
+        /* Zero row padding, like real BMP writers */
+        for(uint y = 0; y < cover->height; y++)
+        {
+            memset(pixels + (size_t) y * row_len + cover->width * cover->channels, 0, row_len - cover->width * cover->channels);
+        }
+
+        test_put_le(header + 2, 54 + span, 4);
+        test_put_le(header + 10, 54, 4);
+        test_put_le(header + 14, 40, 4);
+        test_put_le(header + 18, cover->width, 4);
+        test_put_le(header + 22, cover->height, 4);
+        test_put_le(header + 26, 1, 2);
+        test_put_le(header + 28, cover->channels * 8, 2);
+        test_put_le(header + 34, span, 4);
+        fwrite(header, 1, sizeof (header), fptr);
+        fwrite(pixels, 1, span, fptr);
+    }
+    else if(strcmp(cover->format, "ppm") == 0 || strcmp(cover->format, "pgm") == 0)
+    {
+        fprintf(fptr, "%s\n# stego test\n%u %u\n255\n", cover->channels == 3 ? "P6" : "P5", cover->width, cover->height);
+        fwrite(pixels, 1, (size_t) row_len * cover->height, fptr);
+    }
+    else if(strcmp(cover->format, "tga") == 0)
+    {
+        unsigned char header[18] = { 0 };
+
+        /* An image id in front of the pixels */
+        header[0] = 5;
+        header[2] = cover->channels == 1 ? 3 : 2;
+        test_put_le(header + 12, cover->width, 2);
+        test_put_le(header + 14, cover->height, 2);
+        header[16] = cover->channels * 8;
+        fwrite(header, 1, sizeof (header), fptr);
+        fwrite("stego", 1, 5, fptr);
+        fwrite(pixels, 1, (size_t) row_len * cover->height, fptr);
+    }
+    else if(strcmp(cover->format, "png") == 0)
+    {
+        ret = test_write_png(fptr, cover, pixels);
+    }
+    else
+    {
+        ret = e_failure;
+    }
+
+    free(pixels);
+    if(fclose(fptr) != 0)
+    {
+        ret = e_failure;
+    }
+
+    return ret;
+}
+
+/* Function definition to write a secret file of random bytes */
+Status test_make_secret(const char *fname, uint size, unsigned long long seed)
+{
+    unsigned char *buf = malloc(size + 1);
+    FILE *fptr = fopen(fname, "w");
+    TestRand rand;
+    Status ret;
+
+    if(buf == NULL || fptr == NULL)
+    {
+        free(buf);
+        if(fptr != NULL)
+            fclose(fptr);
+        return e_failure;
+    }
+
+    test_rand_seed(&rand, seed);
+    test_rand_fill(&rand, buf, size);
+    ret = fwrite(buf, 1, size, fptr) == size ? e_success : e_failure;
+    free(buf);
+    if(fclose(fptr) != 0)
+    {
+        ret = e_failure;
+    }
+
+    return ret;
+}
+
+/* Function definition to read a whole file */
+unsigned char *test_read_file(const char *fname, long *size)
+{
+    FILE *fptr = fopen(fname, "r");
+    unsigned char *buf;
+
+    if(fptr == NULL)
+    {
+        return NULL;
+    }
+
+    fseek(fptr, 0, SEEK_END);
+    *size = ftell(fptr);
+    rewind(fptr);
+
+    buf = malloc(*size + 1);
+    if(buf != NULL && fread(buf, 1, *size, fptr) != (size_t) *size)
+    {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(fptr);
+
+    return buf;
+}
+
+/* Function definition to compare two files byte by byte */
+int test_same_file(const char *a, const char *b)
+{
+    long size_a, size_b;
+    unsigned char *buf_a = test_read_file(a, &size_a);
+    unsigned char *buf_b = test_read_file(b, &size_b);
+    int same = buf_a != NULL && buf_b != NULL && size_a == size_b && memcmp(buf_a, buf_b, size_a) == 0;
+
+    free(buf_a);
+    free(buf_b);
+
+    return same;
+}
+
+/* Add bytes to an FNV-1a 64 hash */
+static unsigned long long test_fnv(unsigned long long hash, const unsigned char *buf, size_t n)
+{
+    for(size_t i = 0; i < n; i++)
+    {
+        hash = (hash ^ buf[i]) * FNV_PRIME;
+    }
+
+    return hash;
+}
+
+/* Function definition to hash a whole file */
+unsigned long long test_hash_file(const char *fname)
+{
+    long size;
+    unsigned char *buf = test_read_file(fname, &size);
+    unsigned long long hash;
+
+    if(buf == NULL)
+    {
+        return 0;
+    }
+    hash = test_fnv(FNV_OFFSET, buf, size);
+    free(buf);
+
+    return hash;
+}
+
+/* Function definition to hash the pixel span of an image */
+unsigned long long test_hash_span(const char *fname)
+{
+    const CoverFormat *format = cover_format_for_fname(fname);
+    FILE *fptr = fopen(fname, "r");
+    unsigned long long hash = FNV_OFFSET;
+    CoverInfo cover;
+    char buf[COVER_COPY_BUF_SIZE];
+    uint n;
+
+    memset(&cover, 0, sizeof (cover));
+    if(format == NULL || fptr == NULL ||
+       cover_parse_header(format, fptr, &cover) == e_failure ||
+       format->begin_span(fptr, NULL, &cover) == e_failure)
+    {
+        hash = 0;
+    }
+    else
+    {
+        while(cover.span_pos < cover.pixel_span && (n = cover_read_channels(&cover, fptr, buf, sizeof (buf))) > 0)
+        {
+            hash = test_fnv(hash, (const unsigned char *) buf, n);
+        }
+        if(cover.span_pos != cover.pixel_span)
+        {
+            hash = 0;
+        }
+    }
+
+    cover_release(&cover);
+    if(fptr != NULL)
+    {
+        fclose(fptr);
+    }
+
+    return hash;
+}
+
+/* Point stdout at /dev/null, returns the saved descriptor */
+static int test_mute(void)
+{
+    int saved = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+
+    fflush(stdout);
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+
+    return saved;
+}
+
+/* Put stdout back */
+static void test_unmute(int saved)
+{
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+}
+
+/* Open a file as a memory stream, the buffer is owned by the caller */
+static FILE *test_open_memory(const char *fname, unsigned char **buf)
+{
+    long size;
+
+    *buf = test_read_file(fname, &size);
+
+    return *buf != NULL ? fmemopen(*buf, size, "r") : NULL;
+}
+
+/* Function definition to encode through do_encoding */
+Status test_encode(const TestJob *job)
+{
+    EncodeInfo encInfo;
+    unsigned char *cover_buf = NULL;
+    Status ret;
+    int saved;
+
+    memset(&encInfo, 0, sizeof (encInfo));
+    encInfo.cover.format = cover_format_for_fname(job->cover_fname);
+    encInfo.src_image_fname = (char *) job->cover_fname;
+    encInfo.secret_fname = (char *) job->secret_fname;
+    encInfo.stego_image_fname = (char *) job->stego_fname;
+    encInfo.io_backend = job->io_backend;
+    encInfo.adaptive = job->adaptive;
+    encInfo.key_phrase = job->key_phrase;
+    encInfo.hamming_k = job->hamming_k;
+    encInfo.archive_fnames = job->archive_fnames;
+    encInfo.cover_header = job->cover_header;
+
+    if(encInfo.cover.format == NULL)
+    {
+        return e_failure;
+    }
+    if(job->in_memory && (encInfo.fptr_src_image = test_open_memory(job->cover_fname, &cover_buf)) == NULL)
+    {
+        free(cover_buf);
+        return e_failure;
+    }
+
+    saved = test_mute();
+    ret = do_encoding(&encInfo);
+    close_files(&encInfo);
+    test_unmute(saved);
+    free(cover_buf);
+
+    return ret;
+}
+
+/* Function definition to decode through do_decoding */
+Status test_decode(const TestJob *job)
+{
+    DecodeInfo decInfo;
+    unsigned char *stego_buf = NULL;
+    Status ret;
+    int saved;
+
+    memset(&decInfo, 0, sizeof (decInfo));
+    decInfo.cover.format = cover_format_for_fname(job->stego_fname);
+    decInfo.stego_image_fname = (char *) job->stego_fname;
+    decInfo.decode_fname = (char *) job->decode_fname;
+    decInfo.io_backend = job->io_backend;
+    decInfo.key_phrase = job->key_phrase;
+    decInfo.list_archive = job->list_archive;
+    decInfo.extract_name = job->extract_name;
+
+    if(decInfo.cover.format == NULL)
+    {
+        return e_failure;
+    }
+    if(job->in_memory && (decInfo.fptr_stego_image = test_open_memory(job->stego_fname, &stego_buf)) == NULL)
+    {
+        free(stego_buf);
+        return e_failure;
+    }
+
+    saved = test_mute();
+    ret = do_decoding(&decInfo);
+    close_decode_files(&decInfo);
+    test_unmute(saved);
+    free(stego_buf);
+
+    return ret;
+}
+
+/* Function definition to get the secret data bytes of the plain or Hamming layout */
+uint test_capacity(const char *cover_fname, uint hamming_k)
+{
+    const CoverFormat *format = cover_format_for_fname(cover_fname);
+    FILE *fptr = fopen(cover_fname, "r");
+    CoverInfo cover;
+    uint capacity = 0;
+
+    memset(&cover, 0, sizeof (cover));
+    if(format != NULL && fptr != NULL && cover_parse_header(format, fptr, &cover) == e_success)
+    {
+        capacity = hamming_k ? get_hamming_capacity(cover.pixel_span, hamming_k) : get_payload_capacity(cover.pixel_span);
+    }
+
+    cover_release(&cover);
+    if(fptr != NULL)
+    {
+        fclose(fptr);
+    }
+
+    return capacity;
+}
@@ -0,0 +1,117 @@
+/* This file contains the helpers shared by the test programs */
+
+#ifndef TEST_SUPPORT_H
+#define TEST_SUPPORT_H
+
+#include <stdio.h>
+#include "../types.h" // Contains user defined types
+#include "../io_engine.h" // Contains the I/O backends
+#include "../cover.h" // Contains the cover format layer
+
+#define TEST_PATH_SIZE 512
+
+/* Report a failed check and count it, the test keeps going */
+#define TEST_CHECK(cond, ...) \
+    do { \
+        if(!(cond)) \
+        { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            test_failures++; \
+        } \
+    } while(0)
+
+/* Failed checks so far, the exit status of every test program */
+extern int test_failures;
+
+/* Reproducible random numbers, the seed is printed by the tests */
+typedef struct _TestRand
+{
+    unsigned long long state;
+} TestRand;
+
+/*
+ * Synthetic cover image. Pixels are a gradient with noise whose
+ * amplitude changes from one 8x8 block to the next, so covers have
+ * flat and textured regions for adaptive embedding.
+ */
+typedef struct _TestCover
+{
+    const char *format;         // bmp, ppm, pgm, tga or png
+    uint width;
+    uint height;
+    uint channels;              // Channel bytes per pixel
+    unsigned long long seed;
+} TestCover;
+
+/* One encode and decode run through the library */
+typedef struct _TestJob
+{
+    const char *cover_fname;
+    const char *secret_fname;
+    const char *stego_fname;
+    const char *decode_fname;
+    IoBackend io_backend;
+    int in_memory;              // Images read from memory, as stegod does with cached covers
+    const CoverInfo *cover_header;  // Header parsed before, as stegod keeps with cached covers
+    int adaptive;
+    const char *key_phrase;
+    uint hamming_k;
+    char **archive_fnames;      // Members to embed as an archive instead of the secret file
+    int list_archive;
+    const char *extract_name;   // Archive member to decode
+} TestJob;
+
+/* Seed the generator */
+void test_rand_seed(TestRand *rand, unsigned long long seed);
+
+/* Next 32 random bits */
+uint test_rand(TestRand *rand);
+
+/* Random number in [lo, hi] */
+uint test_rand_range(TestRand *rand, uint lo, uint hi);
+
+/* Fill a buffer with random bytes */
+void test_rand_fill(TestRand *rand, unsigned char *buf, size_t n);
+
+/* Create a temporary directory for the files of a test */
+Status test_temp_dir(char *dir, uint size);
+
+/* Remove the temporary directory and everything in it */
+void test_remove_dir(const char *dir);
+
+/* Join a directory and a file name */
+const char *test_path(char *buf, const char *dir, const char *name);
+
+/* File extension of a test cover format */
+const char *test_cover_extn(const TestCover *cover);
+
+/* Write a synthetic cover image */
+Status test_make_cover(const char *fname, const TestCover *cover);
+
+/* Write a secret file of random bytes */
+Status test_make_secret(const char *fname, uint size, unsigned long long seed);
+
+/* Read a whole file, the buffer is malloc'ed */
+unsigned char *test_read_file(const char *fname, long *size);
+
+/* Compare two files byte by byte */
+int test_same_file(const char *a, const char *b);
+
+/* FNV-1a 64 of a whole file, 0 when it can not be read */
+unsigned long long test_hash_file(const char *fname);
+
+/* FNV-1a 64 of the pixel span of an image, independent of how the format compresses it */
+unsigned long long test_hash_span(const char *fname);
+
+/* Encode through do_encoding, the progress messages go to /dev/null */
+Status test_encode(const TestJob *job);
+
+/* Decode through do_decoding, the progress messages go to /dev/null */
+Status test_decode(const TestJob *job);
+
+/* Secret data bytes the cover holds in the plain or Hamming layout */
+uint test_capacity(const char *cover_fname, uint hamming_k);
+
+#endif
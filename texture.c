@@ -0,0 +1,333 @@
+/* This file contains codes related to the texture map of adaptive embedding */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "texture.h"
+#include "types.h"
+#include "cover.h"
+
+#define TEXTURE_SCAN_BUF_SIZE 4096
+#define TEXTURE_DEFAULT_KEY 0x5eed5eed5eed5eedULL
+
+/* Function Definitions */
+
+/* Function definition to set up an empty map */
+Status texture_map_init(TextureMap *map, const CoverInfo *cover, uint reserved)
+{
+    memset(map, 0, sizeof (TextureMap));
+
+    map->row_len = cover->width * cover->channels;
+    map->row_stride = cover->row_stride > map->row_len ? cover->row_stride : map->row_len;
+    map->block_bytes = TEXTURE_BLOCK_SIZE * cover->channels;
+    map->blocks_x = cover->width / TEXTURE_BLOCK_SIZE;
+    map->blocks_y = cover->height / TEXTURE_BLOCK_SIZE;
+    map->reserved = reserved;
+
+    /* calloc keeps an image without full blocks a valid, empty map */
+    map->levels = calloc((size_t) map->blocks_x * map->blocks_y + 1, 1);
+    map->sum = calloc(map->blocks_x + 1, sizeof (unsigned long long));
+    map->sum_sq = calloc(map->blocks_x + 1, sizeof (unsigned long long));
+    if(map->levels == NULL || map->sum == NULL || map->sum_sq == NULL)
+    {
+        texture_map_free(map);
+        return e_failure;
+    }
+
+    return e_success;
+}
+
+/* Function definition to free the map */
+void texture_map_free(TextureMap *map)
+{
+    free(map->levels);
+    free(map->sum);
+    free(map->sum_sq);
+    map->levels = NULL;
+    map->sum = NULL;
+    map->sum_sq = NULL;
+}
+
+/* Log scale of n times the variance, 4 steps per power of two, integer only so every platform agrees */
+static unsigned char texture_level(unsigned long long n_var)
+{
+    uint bits = 0;
+    uint level;
+
+    if(n_var == 0)
+    {
+        return 0;
+    }
+
+    while((n_var >> bits) > 1)
+    {
+        bits++;
+    }
+
+    level = 1 + 4 * bits + (bits >= 2 ? (n_var >> (bits - 2)) & 3 : 0);
+
+    return level < TEXTURE_LEVELS ? level : TEXTURE_LEVELS - 1;
+}
+
+/* Turn the accumulators of a finished row of blocks into levels */
+static void texture_close_block_row(TextureMap *map, uint by)
+{
+    unsigned long long n = (unsigned long long) TEXTURE_BLOCK_SIZE * map->block_bytes;
+
+    for(uint bx = 0; bx < map->blocks_x; bx++)
+    {
+        unsigned long long start = (unsigned long long) by * TEXTURE_BLOCK_SIZE * map->row_stride + bx * map->block_bytes;
+        unsigned long long n_var = (n * map->sum_sq[bx] - map->sum[bx] * map->sum[bx]) / n;
+
+        /* Blocks overlapping the header stay at level 0, their first byte is the lowest */
+        map->levels[by * map->blocks_x + bx] = start < map->reserved ? 0 : texture_level(n_var);
+        map->sum[bx] = 0;
+        map->sum_sq[bx] = 0;
+    }
+}
+
+/* Function definition to add the next n span bytes to the map */
+void texture_map_update(TextureMap *map, TextureCursor *cursor, const unsigned char *buf, uint n)
+{
+    while(n > 0)
+    {
+        uint row = cursor->row;
+        uint col = cursor->col;
+        int in_block;
+        uint len = texture_run(map, cursor, n, 0, &in_block);
+
+        /* Only full blocks are mapped, the sums are branch free so the compiler vectorizes them */
+        if(row / TEXTURE_BLOCK_SIZE < map->blocks_y && col < map->row_len && col / map->block_bytes < map->blocks_x)
+        {
+            uint sum = 0;
+            uint sum_sq = 0;
+
+            for(uint i = 0; i < len; i++)
+            {
+                uint v = buf[i] >> 1;
+
+                sum += v;
+                sum_sq += v * v;
+            }
+            map->sum[col / map->block_bytes] += sum;
+            map->sum_sq[col / map->block_bytes] += sum_sq;
+
+            /* The last byte of a row of blocks closes it */
+            if(row % TEXTURE_BLOCK_SIZE == TEXTURE_BLOCK_SIZE - 1 && col + len == map->blocks_x * map->block_bytes)
+            {
+                texture_close_block_row(map, row / TEXTURE_BLOCK_SIZE);
+            }
+        }
+
+        buf += len;
+        n -= len;
+    }
+}
+
+/* Function definition to count the slots per level */
+void texture_map_finish(TextureMap *map)
+{
+    unsigned long long block_slots = (unsigned long long) TEXTURE_BLOCK_SIZE * map->block_bytes;
+
+    memset(map->level_slots, 0, sizeof (map->level_slots));
+    for(unsigned long long i = 0; i < (unsigned long long) map->blocks_x * map->blocks_y; i++)
+    {
+        map->level_slots[map->levels[i]] += block_slots;
+    }
+}
+
+/* Function definition to build the map of a cover in one pass */
+Status texture_map_scan(TextureMap *map, const CoverFormat *format, FILE *fptr, uint reserved)
+{
+    unsigned char buf[TEXTURE_SCAN_BUF_SIZE];
+    TextureCursor cursor = { 0, 0 };
+    CoverInfo cover;
+    uint n;
+
+    if(cover_parse_header(format, fptr, &cover) == e_failure || format->begin_span(fptr, NULL, &cover) == e_failure)
+    {
+        cover_release(&cover);
+        return e_failure;
+    }
+
+    if(texture_map_init(map, &cover, reserved) == e_failure)
+    {
+        cover_release(&cover);
+        return e_failure;
+    }
+
+    while(cover.span_pos < cover.pixel_span)
+    {
+        n = cover.pixel_span - cover.span_pos;
+        n = cover_read_channels(&cover, fptr, (char *) buf, n < TEXTURE_SCAN_BUF_SIZE ? n : TEXTURE_SCAN_BUF_SIZE);
+        if(n == 0)
+        {
+            break;
+        }
+        texture_map_update(map, &cursor, buf, n);
+    }
+    cover_release(&cover);
+
+    /* A truncated span gives no map */
+    if(cover.span_pos != cover.pixel_span)
+    {
+        texture_map_free(map);
+        return e_failure;
+    }
+    texture_map_finish(map);
+
+    return e_success;
+}
+
+/* Function definition to count the payload slots at or above a level */
+unsigned long long texture_slots(const TextureMap *map, uint threshold)
+{
+    unsigned long long slots = 0;
+
+    /* Level 0 never carries payload */
+    for(uint level = threshold > 0 ? threshold : 1; level < TEXTURE_LEVELS; level++)
+    {
+        slots += map->level_slots[level];
+    }
+
+    return slots;
+}
+
+/* Function definition to find the highest level whose blocks hold the bits */
+uint texture_threshold(const TextureMap *map, unsigned long long bits)
+{
+    unsigned long long slots = 0;
+
+    for(uint level = TEXTURE_LEVELS - 1; level > 0; level--)
+    {
+        slots += map->level_slots[level];
+        if(slots >= bits && slots > 0)
+        {
+            return level;
+        }
+    }
+
+    return 0;
+}
+
+/* Function definition to find the run of bytes from the cursor sharing one block */
+uint texture_run(const TextureMap *map, TextureCursor *cursor, uint n, uint threshold, int *eligible)
+{
+    uint bx = map->block_bytes > 0 ? cursor->col / map->block_bytes : 0;
+    uint by = cursor->row / TEXTURE_BLOCK_SIZE;
+    uint len;
+
+    *eligible = 0;
+    if(cursor->col >= map->row_len)
+    {
+        /* Row padding */
+        len = map->row_stride - cursor->col;
+    }
+    else if(bx >= map->blocks_x || by >= map->blocks_y)
+    {
+        /* Partial blocks at the right edge, or rows below the last full block */
+        len = bx >= map->blocks_x ? map->row_len - cursor->col : (bx + 1) * map->block_bytes - cursor->col;
+    }
+    else
+    {
+        len = (bx + 1) * map->block_bytes - cursor->col;
+        *eligible = threshold > 0 && map->levels[by * map->blocks_x + bx] >= threshold;
+    }
+
+    len = len < n ? len : n;
+    cursor->col += len;
+    if(cursor->col == map->row_stride)
+    {
+        cursor->col = 0;
+        cursor->row++;
+    }
+
+    return len;
+}
+
+/* Function definition to move the cursor n bytes on */
+void texture_cursor_advance(const TextureMap *map, TextureCursor *cursor, uint n)
+{
+    int eligible;
+
+    while(n > 0)
+    {
+        n -= texture_run(map, cursor, n, 0, &eligible);
+    }
+}
+
+/* Mix 64 bits (splitmix64 finalizer) */
+static unsigned long long texture_mix(unsigned long long x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+
+    return x;
+}
+
+/* Function definition to derive the key from a pass phrase (FNV-1a) */
+unsigned long long texture_key(const char *phrase)
+{
+    unsigned long long key = 0xcbf29ce484222325ULL;
+
+    if(phrase == NULL)
+    {
+        return TEXTURE_DEFAULT_KEY;
+    }
+
+    for(; *phrase != '\0'; phrase++)
+    {
+        key ^= (unsigned char) *phrase;
+        key *= 0x100000001b3ULL;
+    }
+
+    return key;
+}
+
+/* Function definition to set up the permutation */
+void keyed_permutation_init(KeyedPermutation *perm, uint size, unsigned long long key)
+{
+    perm->size = size;
+    perm->key = key;
+    perm->half_bits = 1;
+
+    /* Domain of 4^half_bits, at most four times size so cycle walking stays short */
+    while(perm->half_bits < 16 && (1ULL << (2 * perm->half_bits)) < size)
+    {
+        perm->half_bits++;
+    }
+}
+
+/* One pass of the Feistel network over the domain */
+static uint keyed_feistel(const KeyedPermutation *perm, uint x)
+{
+    uint mask = (1u << perm->half_bits) - 1;
+    uint left = x >> perm->half_bits;
+    uint right = x & mask;
+
+    for(uint round = 0; round < TEXTURE_FEISTEL_ROUNDS; round++)
+    {
+        uint f = texture_mix(perm->key ^ ((unsigned long long) round << 32) ^ right) & mask;
+        uint next = left ^ f;
+
+        left = right;
+        right = next;
+    }
+
+    return (left << perm->half_bits) | right;
+}
+
+/* Function definition to find the position of slot s in the permuted order */
+uint keyed_permute(const KeyedPermutation *perm, uint s)
+{
+    /* Values outside the range are walked on until they land inside, which keeps it a bijection */
+    do
+    {
+        s = keyed_feistel(perm, s);
+    } while(s >= perm->size);
+
+    return s;
+}
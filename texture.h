@@ -0,0 +1,102 @@
+/* This file contains the function prototypes and structs for the texture map of adaptive embedding */
+
+#include <stdio.h>
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include "types.h" // Contains user defined types
+#include "cover.h" // Contains cover image formats
+
+#define TEXTURE_BLOCK_SIZE 8        // Blocks are 8x8 pixels, all channels together
+#define TEXTURE_LEVELS 256
+#define TEXTURE_FEISTEL_ROUNDS 4
+
+/*
+ * Structure to store the texture map of a cover.
+ * The span is cut into blocks of 8x8 pixels and each block
+ * gets a texture level, a log scale of the variance of its
+ * samples with the LSB masked off, so embedding never changes
+ * the map and the decoder rebuilds it from the stego image.
+ * Level 0 blocks (flat, partial at the edges, or overlapping
+ * the header at the start of the span) never carry payload.
+ * The map is built in one pass over the span, holding one
+ * byte per block plus accumulators for one row of blocks.
+ */
+typedef struct _TextureMap
+{
+    /* Span geometry */
+    uint row_len;               // Sample bytes in a row
+    uint row_stride;            // Span bytes from one row to the next
+    uint block_bytes;           // Bytes of one block in one row
+    uint blocks_x;
+    uint blocks_y;
+    uint reserved;              // Bytes at the start of the span holding the header
+
+    /* One level per block, and payload slots available per level */
+    unsigned char *levels;
+    unsigned long long level_slots[TEXTURE_LEVELS];
+
+    /* Accumulators for the row of blocks being scanned */
+    unsigned long long *sum;
+    unsigned long long *sum_sq;
+
+} TextureMap;
+
+/* Position in the span while walking it */
+typedef struct _TextureCursor
+{
+    uint row;
+    uint col;
+
+} TextureCursor;
+
+/*
+ * Keyed bijection on [0, size), the order in which payload bits
+ * are spread over the slots. A Feistel network on the smallest
+ * even power of two holding size, cycle walking into range.
+ */
+typedef struct _KeyedPermutation
+{
+    uint size;
+    uint half_bits;
+    unsigned long long key;
+
+} KeyedPermutation;
+
+/* Set up an empty map for the cover geometry */
+Status texture_map_init(TextureMap *map, const CoverInfo *cover, uint reserved);
+
+/* Add the next n span bytes to the map */
+void texture_map_update(TextureMap *map, TextureCursor *cursor, const unsigned char *buf, uint n);
+
+/* Count the slots per level once the whole span is added */
+void texture_map_finish(TextureMap *map);
+
+/* Free the map */
+void texture_map_free(TextureMap *map);
+
+/* Build the map of a cover in one pass, the cover is released afterwards */
+Status texture_map_scan(TextureMap *map, const CoverFormat *format, FILE *fptr, uint reserved);
+
+/* Payload slots in blocks at or above the level */
+unsigned long long texture_slots(const TextureMap *map, uint threshold);
+
+/* Highest level whose blocks hold the bits, 0 when they do not fit */
+uint texture_threshold(const TextureMap *map, unsigned long long bits);
+
+/* Bytes from the cursor on sharing one block, at most n, and whether they carry payload */
+uint texture_run(const TextureMap *map, TextureCursor *cursor, uint n, uint threshold, int *eligible);
+
+/* Move the cursor n bytes on */
+void texture_cursor_advance(const TextureMap *map, TextureCursor *cursor, uint n);
+
+/* Key for the permutation from a pass phrase, NULL gives the default key */
+unsigned long long texture_key(const char *phrase);
+
+/* Set up the permutation */
+void keyed_permutation_init(KeyedPermutation *perm, uint size, unsigned long long key);
+
+/* Position of slot s in the permuted order */
+uint keyed_permute(const KeyedPermutation *perm, uint s);
+
+#endif
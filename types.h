@@ -11,11 +11,15 @@ typedef enum
     e_failure
 } Status;
 
-/* Operation will be used to check encode or decode mode */
+/* Operation will be used to check encode, decode, plan, daemon, client or analyze mode */
 typedef enum
 {
     e_encode,
     e_decode,
+    e_plan,
+    e_daemon,
+    e_client,
+    e_analyze,
     e_unsupported
 } OperationType;
 